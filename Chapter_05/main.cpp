@@ -11,6 +11,7 @@ using namespace std;
 #include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
 #include "utils/MultipleImageWindow.h"
+#include "utils/StripLabeling.h"
 
 using namespace cv;
 
@@ -25,6 +26,7 @@ const char *keys =
                 "{@lightPattern || Image light pattern to apply to image input}"
                 "{lightMethod | 1 | Method to remove background light, 0 difference, 1 div, 2 no light removal' }"
                 "{segMethod | 1 | Method to segment: 1 connected Components, 2 connecte components with stats, 3 find Contours }"
+                "{strips | 0 | Also process the image in parallel strips of N rows and compare with the whole image, 0 disables it}"
         };
 
 static Scalar randomColor(RNG &rng);
@@ -37,6 +39,8 @@ void ConnectedComponentsStats(Mat img);
 
 void FindContoursBasic(Mat img);
 
+void ConnectedComponentsStrips(Mat img, Mat pattern, int method_light, int strip_rows, Mat img_thr);
+
 Mat removeLight(Mat img, Mat pattern, int method);
 
 int main(int argc, const char **argv) {
@@ -52,6 +56,7 @@ int main(int argc, const char **argv) {
     String light_pattern_file = parser.get<String>(1);
     auto method_light = parser.get<int>("lightMethod");
     auto method_seg = parser.get<int>("segMethod");
+    auto strip_rows = parser.get<int>("strips");
 
     // Check if params are correctly parsed in his variables
     if (!parser.check()) {
@@ -132,6 +137,9 @@ int main(int argc, const char **argv) {
             ConnectedComponents(img_thr);
     }
 
+    if (strip_rows > 0)
+        ConnectedComponentsStrips(img, light_pattern, method_light, strip_rows, img_thr);
+
     miw->render();
     waitKey(0);
     return 0;
@@ -246,6 +254,58 @@ void FindContoursBasic(Mat const img) {
     miw->addImage("FindContoursBasic Result", output);
 }
 
+/**
+ * Preprocess and label the image in strips of strip_rows rows processed in
+ * parallel, with the memory of a strip for each thread, and compare the
+ * result with the whole binary image
+ * @param img Mat input image
+ * @param pattern Mat light pattern
+ * @param method_light int method to remove background light
+ * @param strip_rows int number of rows of each strip
+ * @param img_thr Mat binary image of the whole image
+ */
+void ConnectedComponentsStrips(Mat const img, Mat const pattern, int const method_light, int const strip_rows,
+                               Mat const img_thr) {
+    // Same steps as the whole image, the median filter needs 1 row of each neighbour strip
+    auto preprocess = [method_light](const Mat &rows, const Mat &rows_pattern, Mat &binary) {
+        Mat rows_noise;
+        medianBlur(rows, rows_noise, 3);
+        if (method_light != 2) {
+            threshold(removeLight(rows_noise, rows_pattern, method_light), binary, 30, 255, THRESH_BINARY);
+        } else {
+            threshold(rows_noise, binary, 140, 255, THRESH_BINARY_INV);
+        }
+    };
+    Mat stats, centroids;
+    auto start = getTickCount();
+    auto num_objects = connectedComponentsWithStatsInStrips(img, pattern, strip_rows, 1, preprocess,
+                                                            stats, centroids);
+    auto strips_ms = (getTickCount() - start) * 1000.0 / getTickFrequency();
+
+    Mat labels, whole_stats, whole_centroids;
+    start = getTickCount();
+    auto whole_objects = connectedComponentsWithStats(img_thr, labels, whole_stats, whole_centroids);
+    auto whole_ms = (getTickCount() - start) * 1000.0 / getTickFrequency();
+    cout << "Strips of " << strip_rows << " rows: " << num_objects - 1 << " objects in " << strips_ms
+         << " ms (preprocessing and labeling), whole image: " << whole_objects - 1 << " objects in "
+         << whole_ms << " ms (labeling)" << endl;
+
+    // Draw the bounding box and area of each object
+    Mat output;
+    cvtColor(img, output, COLOR_GRAY2BGR);
+    RNG rng(0xFFFFFFFF);
+    for (auto i = 1; i < num_objects; i++) {
+        Rect box(stats.at<int>(i, CC_STAT_LEFT), stats.at<int>(i, CC_STAT_TOP),
+                 stats.at<int>(i, CC_STAT_WIDTH), stats.at<int>(i, CC_STAT_HEIGHT));
+        rectangle(output, box, randomColor(rng));
+        stringstream ss;
+        ss << "area: " << stats.at<int>(i, CC_STAT_AREA);
+        putText(output, ss.str(), centroids.at<Point2d>(i), FONT_HERSHEY_SIMPLEX, 0.4, Scalar(255, 255, 255));
+    }
+    // The window grid is full, show it in its own window
+    imshow("Strips Result", output);
+}
+
 /**
  * Remove th light and return new image without light
  * @param img Mat image to remove the light pattern
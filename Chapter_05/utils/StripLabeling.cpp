@@ -0,0 +1,152 @@
+#include "StripLabeling.h"
+
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace {
+
+/**
+ * Labels of a strip: the stats of each label with global coordinates and the
+ * labels of its first and last rows, used to stitch it with its neighbours
+ */
+struct StripResult {
+    int num_labels;
+    Mat stats;
+    Mat centroids;
+    vector<int> first_row, last_row;
+};
+
+/**
+ * Sums of the pixels of a stitched object
+ */
+struct ObjectSums {
+    int64 area;
+    double sum_x, sum_y;
+    int left, top, right, bottom;
+};
+
+int findRoot(vector<int> &parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+void join(vector<int> &parent, int a, int b) {
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    // The lowest index is the root, it is the first piece in raster order
+    if (a < b)
+        parent[b] = a;
+    else if (b < a)
+        parent[a] = b;
+}
+
+}
+
+int connectedComponentsWithStatsInStrips(Mat img, Mat pattern, int strip_rows, int halo,
+                                         StripPreprocess preprocess, Mat &stats, Mat &centroids) {
+    int num_strips = (img.rows + strip_rows - 1) / strip_rows;
+    vector<StripResult> strips(num_strips);
+
+    // Each strip is preprocessed and labeled alone and writes only its own slot
+    parallel_for_(Range(0, num_strips), [&](const Range &range) {
+        for (int s = range.start; s < range.end; s++) {
+            int y0 = s * strip_rows;
+            int y1 = min(img.rows, y0 + strip_rows);
+            int a0 = max(0, y0 - halo);
+            int a1 = min(img.rows, y1 + halo);
+            // Copy the rows so the filters replicate the image borders as in the whole image
+            Mat rows = img.rowRange(a0, a1).clone();
+            Mat binary;
+            preprocess(rows, pattern.rowRange(a0, a1), binary);
+            Mat core = binary.rowRange(y0 - a0, y1 - a0);
+
+            StripResult &result = strips[s];
+            Mat labels;
+            result.num_labels = connectedComponentsWithStats(core, labels, result.stats, result.centroids, 8, CV_32S);
+            // Stats in image coordinates
+            for (int i = 0; i < result.num_labels; i++) {
+                result.stats.at<int>(i, CC_STAT_TOP) += y0;
+                result.centroids.at<double>(i, 1) += y0;
+            }
+            result.first_row.assign(labels.ptr<int>(0), labels.ptr<int>(0) + labels.cols);
+            result.last_row.assign(labels.ptr<int>(labels.rows - 1), labels.ptr<int>(labels.rows - 1) + labels.cols);
+        }
+    });
+
+    // Global index of the first label of each strip
+    vector<int> offset(num_strips + 1, 0);
+    for (int s = 0; s < num_strips; s++)
+        offset[s + 1] = offset[s] + strips[s].num_labels;
+    vector<int> parent(offset[num_strips]);
+    for (size_t i = 0; i < parent.size(); i++)
+        parent[i] = (int) i;
+
+    // The background of all strips is the label 0, the objects are joined
+    // if a pixel of the first row of a strip touches a pixel of the last row
+    // of the previous strip
+    for (int s = 0; s < num_strips; s++) {
+        join(parent, 0, offset[s]);
+        if (s == 0)
+            continue;
+        const vector<int> &above = strips[s - 1].last_row;
+        const vector<int> &below = strips[s].first_row;
+        for (int x = 0; x < img.cols; x++) {
+            if (below[x] == 0)
+                continue;
+            for (int dx = max(0, x - 1); dx <= min(img.cols - 1, x + 1); dx++) {
+                if (above[dx] != 0)
+                    join(parent, offset[s] + below[x], offset[s - 1] + above[dx]);
+            }
+        }
+    }
+
+    // Merge the stats of the pieces of each object, numbering the objects in
+    // the order of their first piece
+    vector<int> object_label(parent.size(), -1);
+    vector<ObjectSums> objects;
+    for (int s = 0; s < num_strips; s++) {
+        const StripResult &result = strips[s];
+        for (int i = 0; i < result.num_labels; i++) {
+            int root = findRoot(parent, offset[s] + i);
+            if (object_label[root] < 0) {
+                object_label[root] = (int) objects.size();
+                ObjectSums sums = {0, 0, 0, img.cols, img.rows, -1, -1};
+                objects.push_back(sums);
+            }
+            ObjectSums &sums = objects[object_label[root]];
+            const int *st = result.stats.ptr<int>(i);
+            if (st[CC_STAT_AREA] == 0)
+                continue;
+            sums.area += st[CC_STAT_AREA];
+            sums.sum_x += result.centroids.at<double>(i, 0) * st[CC_STAT_AREA];
+            sums.sum_y += result.centroids.at<double>(i, 1) * st[CC_STAT_AREA];
+            sums.left = min(sums.left, st[CC_STAT_LEFT]);
+            sums.top = min(sums.top, st[CC_STAT_TOP]);
+            sums.right = max(sums.right, st[CC_STAT_LEFT] + st[CC_STAT_WIDTH] - 1);
+            sums.bottom = max(sums.bottom, st[CC_STAT_TOP] + st[CC_STAT_HEIGHT] - 1);
+        }
+    }
+
+    int num_labels = (int) objects.size();
+    stats.create(num_labels, CC_STAT_MAX, CV_32S);
+    centroids.create(num_labels, 2, CV_64F);
+    for (int i = 0; i < num_labels; i++) {
+        const ObjectSums &sums = objects[i];
+        int *st = stats.ptr<int>(i);
+        st[CC_STAT_LEFT] = sums.area > 0 ? sums.left : 0;
+        st[CC_STAT_TOP] = sums.area > 0 ? sums.top : 0;
+        st[CC_STAT_WIDTH] = sums.area > 0 ? sums.right - sums.left + 1 : 0;
+        st[CC_STAT_HEIGHT] = sums.area > 0 ? sums.bottom - sums.top + 1 : 0;
+        st[CC_STAT_AREA] = (int) sums.area;
+        centroids.at<double>(i, 0) = sums.area > 0 ? sums.sum_x / sums.area : 0;
+        centroids.at<double>(i, 1) = sums.area > 0 ? sums.sum_y / sums.area : 0;
+    }
+    return num_labels;
+}
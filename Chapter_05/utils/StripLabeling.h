@@ -0,0 +1,49 @@
+/**
+ * Strip Labeling
+ *
+ * Preprocess and label very large images in horizontal strips processed in
+ * parallel, so the float and label buffers only take the size of a strip for
+ * each thread instead of the size of the whole image.
+ *
+ * Each strip is preprocessed with halo rows of its neighbours, enough for
+ * the filters used, and only its own rows are labeled. The objects that
+ * cross the boundary between two strips are stitched comparing the labels
+ * of the last row of a strip with the first row of the next one, with 8
+ * connectivity, and their stats are merged. The result is the same as
+ * labeling the whole preprocessed image, objects are numbered in the raster
+ * order of their first pixel.
+ *
+ */
+
+#ifndef STRIP_LABELING_h
+#define STRIP_LABELING_h
+
+#include <functional>
+
+// OpenCV includes
+#include <opencv2/core.hpp>
+using namespace cv;
+
+/**
+ * Preprocessing of a block of rows of the image and the light pattern,
+ * writes a binary image of the same size
+ */
+typedef std::function<void(const Mat &img, const Mat &pattern, Mat &binary)> StripPreprocess;
+
+/**
+ * Connected components with stats of a preprocessed image processed in strips
+ *
+ * @param Mat img input image
+ * @param Mat pattern light pattern of the same size as the image
+ * @param int strip_rows number of rows of each strip
+ * @param int halo rows of the neighbour strips required by the preprocessing
+ * @param StripPreprocess preprocess binarization of a block of rows
+ * @param Mat stats output CV_32S with a row by label as connectedComponentsWithStats
+ * @param Mat centroids output CV_64F with a row by label as connectedComponentsWithStats
+ * @return int number of labels, label 0 is the background
+ */
+int connectedComponentsWithStatsInStrips(Mat img, Mat pattern, int strip_rows, int halo,
+                                         StripPreprocess preprocess, Mat &stats, Mat &centroids);
+
+
+#endif
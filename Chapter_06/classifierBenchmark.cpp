@@ -0,0 +1,250 @@
+// CLASSIFIER BENCHMARK
+// Train several cv::ml models with the features of the parts dataset and
+// compare their training time, prediction latency, size and test error
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+// OpenCV includes
+#include <opencv2/core.hpp>
+#include <opencv2/ml.hpp>
+
+#include "utils/PartsDataset.h"
+#include "utils/PartsClassifier.h"
+
+using namespace cv;
+using namespace cv::ml;
+
+const char *keys =
+        {
+                "{help h usage ? | | print this message}"
+                "{@pattern | ../data/pattern.pgm | Light pattern image}"
+                "{cache | features.cache | File where store the training features, empty to disable the cache}"
+        };
+
+/**
+ * Model to benchmark, trains and predicts one sample at a time
+ */
+class Candidate {
+public:
+    Candidate(string name) : name(name) {}
+
+    virtual ~Candidate() {}
+
+    virtual void train(Mat samples, Mat responses) = 0;
+
+    virtual float predict(Mat sample) = 0;
+
+    // Size in bytes of the serialized model
+    virtual size_t size() = 0;
+
+    string name;
+};
+
+/**
+ * Size of a serialized algorithm
+ */
+static size_t serializedSize(const Algorithm &model) {
+    FileStorage fs(".yml", FileStorage::WRITE | FileStorage::MEMORY);
+    fs << "model" << "{";
+    model.write(fs);
+    fs << "}";
+    return fs.releaseAndGetString().size();
+}
+
+/**
+ * Any cv::ml classifier
+ */
+class StatModelCandidate : public Candidate {
+public:
+    StatModelCandidate(string name, Ptr<StatModel> model) : Candidate(name), model(model) {}
+
+    void train(Mat samples, Mat responses) {
+        model->train(TrainData::create(samples, ROW_SAMPLE, responses));
+    }
+
+    float predict(Mat sample) {
+        return model->predict(sample);
+    }
+
+    size_t size() {
+        return serializedSize(*model);
+    }
+
+private:
+    Ptr<StatModel> model;
+};
+
+/**
+ * Linear SVM over the explicit chi-squared feature map
+ */
+class Chi2MapCandidate : public Candidate {
+public:
+    Chi2MapCandidate(string name) : Candidate(name), classifier(true) {}
+
+    void train(Mat samples, Mat responses) {
+        classifier.train(classifier.createSVM(), samples, responses);
+    }
+
+    float predict(Mat sample) {
+        classifier.predict(sample, result);
+        return result.at<float>(0);
+    }
+
+    size_t size() {
+        return serializedSize(*classifier.getSVM());
+    }
+
+private:
+    PartsClassifier classifier;
+    Mat result;
+};
+
+/**
+ * cv::ml::Boost only supports two classes, a model is trained for each
+ * class against the rest and the class with the highest sum of votes wins
+ */
+class BoostCandidate : public Candidate {
+public:
+    BoostCandidate(string name, int weak_count) : Candidate(name), weak_count(weak_count) {}
+
+    void train(Mat samples, Mat responses) {
+        double max_label;
+        minMaxLoc(responses, NULL, &max_label);
+        models.clear();
+        for (int label = 0; label <= (int) max_label; label++) {
+            Mat binary = responses == label;
+            binary.convertTo(binary, CV_32S, 1.0 / 255);
+            Ptr<Boost> boost = Boost::create();
+            boost->setBoostType(Boost::REAL);
+            boost->setWeakCount(weak_count);
+            boost->setMaxDepth(2);
+            boost->train(TrainData::create(samples, ROW_SAMPLE, binary));
+            models.push_back(boost);
+        }
+    }
+
+    float predict(Mat sample) {
+        int best = 0;
+        float best_sum = 0;
+        for (size_t label = 0; label < models.size(); label++) {
+            float sum = models[label]->predict(sample, noArray(), StatModel::RAW_OUTPUT);
+            if (label == 0 || sum > best_sum) {
+                best = (int) label;
+                best_sum = sum;
+            }
+        }
+        return (float) best;
+    }
+
+    size_t size() {
+        size_t total = 0;
+        for (size_t i = 0; i < models.size(); i++)
+            total += serializedSize(*models[i]);
+        return total;
+    }
+
+private:
+    int weak_count;
+    vector<Ptr<Boost> > models;
+};
+
+/**
+ * SVM with the parameters of the Chapter 6 application and a kernel
+ */
+static Ptr<SVM> createSVM(int kernel) {
+    Ptr<SVM> svm = PartsClassifier().createSVM();
+    svm->setKernel(kernel);
+    return svm;
+}
+
+int main(int argc, const char **argv) {
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 6. Classifier benchmark v1.0.0");
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+    String light_pattern_file = parser.get<String>(0);
+    String cache_file = parser.get<String>("cache");
+    if (!parser.check()) {
+        parser.printErrors();
+        return 0;
+    }
+
+    Mat light_pattern = loadLightPattern(light_pattern_file);
+    if (light_pattern.empty()) {
+        cout << "ERROR: Not light patter loaded" << endl;
+        return -1;
+    }
+
+    // Same features, train and test data as the Chapter 6 application
+    PartFeatures trainingData, testData;
+    vector<int> responsesData;
+    vector<float> testResponsesData;
+    if (!readPartsDataset(light_pattern, cache_file, trainingData, responsesData, testData, testResponsesData))
+        return -1;
+    Mat samples = trainingData.mat();
+    Mat responses(responsesData.size(), 1, CV_32SC1, &responsesData[0]);
+    Mat testSamples = testData.mat();
+    if (samples.empty() || testSamples.empty()) {
+        cout << "ERROR: Not enough train and test samples" << endl;
+        return -1;
+    }
+    cout << "Train samples: " << samples.rows << ", test samples: " << testSamples.rows
+         << ", features: " << num_features << endl;
+
+    Ptr<KNearest> knn = KNearest::create();
+    knn->setDefaultK(3);
+    knn->setIsClassifier(true);
+    Ptr<RTrees> rtrees = RTrees::create();
+    rtrees->setMaxDepth(10);
+    rtrees->setMinSampleCount(2);
+    rtrees->setTermCriteria(TermCriteria(TermCriteria::MAX_ITER, 100, 0));
+
+    vector<Ptr<Candidate> > candidates;
+    candidates.push_back(makePtr<StatModelCandidate>("SVM CHI2", createSVM(SVM::CHI2)));
+    candidates.push_back(makePtr<StatModelCandidate>("SVM RBF", createSVM(SVM::RBF)));
+    candidates.push_back(makePtr<StatModelCandidate>("SVM INTER", createSVM(SVM::INTER)));
+    candidates.push_back(makePtr<StatModelCandidate>("SVM LINEAR", createSVM(SVM::LINEAR)));
+    candidates.push_back(makePtr<Chi2MapCandidate>("SVM LINEAR chi2 map"));
+    candidates.push_back(makePtr<StatModelCandidate>("KNearest k=3", knn));
+    candidates.push_back(makePtr<StatModelCandidate>("RTrees 100", rtrees));
+    candidates.push_back(makePtr<BoostCandidate>("Boost 100 1-vs-rest", 100));
+
+    cout << left << setw(22) << "Model" << right
+         << setw(12) << "Train ms" << setw(12) << "p50 us" << setw(12) << "p99 us"
+         << setw(12) << "Size KB" << setw(10) << "Error %" << endl;
+    for (size_t c = 0; c < candidates.size(); c++) {
+        Candidate &candidate = *candidates[c];
+        int64 start = getTickCount();
+        candidate.train(samples, responses);
+        double train_ms = (getTickCount() - start) * 1000.0 / getTickFrequency();
+
+        // Predict each test sample alone to measure the latency of one part
+        vector<double> latencies(testSamples.rows);
+        int errors = 0;
+        for (int i = 0; i < testSamples.rows; i++) {
+            Mat sample = testSamples.row(i);
+            int64 predict_start = getTickCount();
+            float result = candidate.predict(sample);
+            latencies[i] = (getTickCount() - predict_start) * 1e6 / getTickFrequency();
+            if (result != testResponsesData[i])
+                errors++;
+        }
+        sort(latencies.begin(), latencies.end());
+        double p50 = latencies[latencies.size() / 2];
+        double p99 = latencies[min(latencies.size() - 1, latencies.size() * 99 / 100)];
+
+        cout << left << setw(22) << candidate.name << right << fixed << setprecision(2)
+             << setw(12) << train_ms << setw(12) << p50 << setw(12) << p99
+             << setw(12) << candidate.size() / 1024.0
+             << setw(10) << 100.0 * errors / testSamples.rows << endl;
+    }
+    return 0;
+}
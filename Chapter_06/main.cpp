@@ -13,39 +13,45 @@ using namespace std;
 #include <opencv2/ml.hpp>
 
 #include "utils/MultipleImageWindow.h"
+#include "utils/PartsDataset.h"
+#include "utils/PartsClassifier.h"
+#include "utils/AllocationCounter.h"
+#include "utils/StripExtractor.h"
 
 using namespace cv;
 using namespace cv::ml;
 
 shared_ptr<MultipleImageWindow> miw;
 Mat light_pattern;
-Ptr<SVM> svm;
+PartsClassifier classifier;
 Scalar green(0, 255, 0), blue(255, 0, 0), red(0, 0, 255);
+String feature_cache_file;
 // OpenCV command line parser functions
 // Keys accecpted by command line parser
 const char *keys =
         {
                 "{help h usage ? | | print this message}"
                 "{@image || Image to classify}"
+                "{@pattern || Light pattern image}"
+                "{threads | -1 | Number of threads used to extract the training features, -1 uses all the cores}"
+                "{cache | features.cache | File where store the training features, empty to disable the cache}"
+                "{model || Trained model file, it is loaded if it matches the training set, else trained and saved}"
+                "{retrain | | Train the model even if the model file matches the training set}"
+                "{benchmark | | Measure the classification time of trays from 10 to 1000 parts}"
+                "{linear | | Use a linear SVM over an explicit chi-squared feature map instead of the CHI2 kernel}"
+                "{strips | 0 | Extract the features of the image in parallel strips of N rows, 0 processes the whole image}"
         };
 
 static Scalar randomColor(RNG &rng);
 
 void plotTrainData(Mat trainData, Mat labels, float *error);
 
-vector<vector<float> > ExtractFeatures(Mat img, vector<int> *left, vector<int> *top);
-
-Mat removeLight(Mat img, Mat pattern);
-
-Mat preprocessImage(Mat input);
-
-bool readFolderAndExtractFeatures(string folder, int label, int num_for_test,
-                                  vector<float> &trainingData, vector<int> &responsesData,
-                                  vector<float> &testData, vector<float> &testResponsesData);
-
 void trainAndTest();
 
+void benchmarkPrediction(Mat img, Mat pre, Mat samples, int strip_rows);
+
 int main(int argc, const char **argv) {
+    int64 start = getTickCount();
     CommandLineParser parser(argc, argv, keys);
     parser.about("Chapter 6. Classification v1.0.0");
     //If requires help show
@@ -59,16 +65,26 @@ int main(int argc, const char **argv) {
         img_file = "../data/test.pgm";
         cout << "using the default image test.pgm!" << endl;
     }
-    String light_pattern_file = parser.get<String>(0);
+    String light_pattern_file = parser.get<String>(1);
     if (light_pattern_file.empty()) {
         light_pattern_file = "../data/pattern.pgm";
         cout << "using the default pattern image" << endl;
     }
+    int num_threads = parser.get<int>("threads");
+    feature_cache_file = parser.get<String>("cache");
+    String model_file = parser.get<String>("model");
+    bool retrain = parser.has("retrain");
+    bool benchmark = parser.has("benchmark");
+    int strip_rows = parser.get<int>("strips");
+    // Linear SVM over an explicit chi-squared feature map instead of the CHI2 kernel
+    classifier = PartsClassifier(parser.has("linear"));
     // Check if params are correctly parsed in his variables
     if (!parser.check()) {
         parser.printErrors();
         return 0;
     }
+    // Negative values restore the default OpenCV number of threads
+    setNumThreads(num_threads);
 
     // Create the Multiple Image Window
     miw = make_shared<MultipleImageWindow>("Main window", 2, 2, WINDOW_AUTOSIZE);
@@ -84,62 +100,83 @@ int main(int argc, const char **argv) {
     cvtColor(img_output, img_output, COLOR_GRAY2BGR);
 
     // Load image to process
-    light_pattern = imread(light_pattern_file, 0);
+    light_pattern = loadLightPattern(light_pattern_file);
     if (light_pattern.data == NULL) {
         // Calculate light pattern
         cout << "ERROR: Not light patter loaded" << endl;
         return 0;
     }
-    medianBlur(light_pattern, light_pattern, 3);
-
-    trainAndTest();
 
-    //// Preprocess image
-    Mat pre = preprocessImage(img);
-    ////End preprocess
+    // Load the trained model if it was trained with the current training set
+    uint64_t training_hash = 0;
+    if (!model_file.empty())
+        training_hash = trainingSetHash(light_pattern);
+    if (model_file.empty() || retrain || !classifier.load(model_file, training_hash)) {
+        trainAndTest();
+        if (!model_file.empty() && !classifier.save(model_file, training_hash))
+            cout << "Can not save the model " << model_file << endl;
+    }
+    cout << "Model ready in " << (getTickCount() - start) * 1000.0 / getTickFrequency() << " ms" << endl;
 
     // Extract features
     vector<int> pos_top, pos_left;
-    vector<vector<float> > features = ExtractFeatures(pre, &pos_left, &pos_top);
+    PartFeatures features;
+    // Binary image, only of the whole image, the strips do not preprocess it at once
+    Mat pre;
+    if (strip_rows > 0) {
+        // Large images are processed in strips with the memory of a strip for each thread
+        features = ExtractFeaturesInStrips(img, light_pattern, strip_rows, &pos_left, &pos_top);
+    } else {
+        //// Preprocess image
+        pre = preprocessImage(img, light_pattern);
+        ////End preprocess
+        features = ExtractFeatures(pre, &pos_left, &pos_top, miw.get());
+    }
 
     cout << "Num objects extracted features " << features.size() << endl;
 
-    for (int i = 0; i < features.size(); i++) {
-
-        cout << "Data Area AR: " << features[i][0] << " " << features[i][1] << endl;
+    // Classify all the objects with one prediction over a matrix with a row for each object
+    Mat samples = features.mat();
+    Mat results;
+    int64 predict_start = getTickCount();
+    if (samples.rows > 0)
+        classifier.predict(samples, results);
+    cout << "Objects classified in " << (getTickCount() - predict_start) * 1000.0 / getTickFrequency() << " ms" << endl;
 
-        Mat trainingDataMat(1, 2, CV_32FC1, &features[i][0]);
-        cout << "Features to predict: " << trainingDataMat << endl;
-        float result = svm->predict(trainingDataMat);
-        cout << result << endl;
+    // Annotate the result of each object
+    for (int i = 0; i < results.rows; i++) {
+        float result = results.at<float>(i);
+        cout << "Features: " << samples.row(i) << " -> " << result << endl;
 
-
-        stringstream ss;
+        String label;
         Scalar color;
         if (result == 0) {
             color = green; // NUT
-            ss << "NUT";
+            label = "NUT";
         } else if (result == 1) {
             color = blue; // RING
-            ss << "RING";
+            label = "RING";
         } else if (result == 2) {
             color = red; // SCREW
-            ss << "SCREW";
+            label = "SCREW";
         }
 
         putText(img_output,
-                ss.str(),
+                label,
                 Point2d(pos_left[i], pos_top[i]),
                 FONT_HERSHEY_SIMPLEX,
                 0.4,
                 color);
-
     }
 
+    if (benchmark)
+        benchmarkPrediction(img, pre, samples, strip_rows);
+
     //vector<int> results= evaluate(features);
 
     // Show images
-    miw->addImage("Binary image", pre);
+    if (!pre.empty())
+        miw->addImage("Binary image", pre);
     miw->addImage("Result", img_output);
     miw->render();
     waitKey(0);
@@ -156,6 +193,9 @@ static Scalar randomColor(RNG &rng) {
 
 
 void plotTrainData(Mat trainData, Mat labels, float *error = NULL) {
+    // The plot uses the first two features
+    if (trainData.cols < 2)
+        return;
     float area_max, ar_max, area_min, ar_min;
     area_max = ar_max = 0;
     area_min = ar_min = 99999999;
@@ -209,210 +249,41 @@ void plotTrainData(Mat trainData, Mat labels, float *error = NULL) {
 }
 
 
-/**
-* Extract the features for all objects in one image
-*
-* @param Mat img input image
-* @param vector<int> left output of left coordinates for each object
-* @param vector<int> top output of top coordintates for each object
-* @return vector< vector<float> > a matrix of rows of features for each object detected
-**/
-vector<vector<float> > ExtractFeatures(Mat img, vector<int> *left = NULL, vector<int> *top = NULL) {
-    // 输出变量
-    // 查找轮廓算法分割中使用的轮廓变量
-    // 输入图像的副本，findcoutours 函数会修改输入图像
-    vector<vector<float> > output;
-    vector<vector<Point> > contours;
-    Mat input = img.clone();
-
-    vector<Vec4i> hierarchy;
-    findContours(input, contours, hierarchy, RETR_CCOMP, CHAIN_APPROX_SIMPLE);
-    // Check the number of objects detected
-    if (contours.empty()) {
-        return output;
-    }
-    RNG rng(0xFFFFFFFF);
-    for (int i = 0; i < contours.size(); i++) {
-        // 黑色图像
-        Mat mask = Mat::zeros(img.rows, img.cols, CV_8UC1);
-        // 使用值1、生成掩膜图像
-        drawContours(mask, contours, i, Scalar(1), FILLED, LINE_8, hierarchy, 1);
-        // 计算区域内的1确定面积
-        Scalar area_s = sum(mask);
-        float area = area_s[0];
-
-        //if the area is greather than min.
-        if (area > 500) {
-
-            RotatedRect r = minAreaRect(contours[i]);
-            float width = r.size.width;
-            float height = r.size.height;
-            float ar = (width < height) ? height / width : width / height;  // 纵横比
-            // 浮点行向量储存数据
-            vector<float> row;
-            row.push_back(area);
-            row.push_back(ar);
-            // 添加到输出向量
-            output.push_back(row);
-            // 如果传递了其它参数，则添加左上角的值以输出这些参数
-            if (left != NULL) {
-                left->push_back((int) r.center.x);
-            }
-            if (top != NULL) {
-                top->push_back((int) r.center.y);
-            }
-            // 显示检测到的对象
-            miw->addImage("Extract Features", mask * 255);
-            // 返回特征向量
-            miw->render();
-            waitKey(10);
-        }
-    }
-    return output;
-}
-
-/**
- * Remove th light and return new image without light
- * @param img Mat image to remove the light pattern
- * @param pattern Mat image with light pattern
- * @return a new image Mat without light
- */
-Mat removeLight(Mat img, Mat pattern) {
-    Mat aux;
-
-    // Require change our image to 32 float for division
-    Mat img32, pattern32;
-    img.convertTo(img32, CV_32F);
-    pattern.convertTo(pattern32, CV_32F);
-    // Divide the image by the pattern
-    aux = 1 - (img32 / pattern32);
-    // Scale it to convert o 8bit format
-    aux = aux * 255;
-    // Convert 8 bits format
-    aux.convertTo(aux, CV_8U);
-
-    //equalizeHist( aux, aux );
-    return aux;
-}
-
-/**
-* Preprocess an input image to extract components and stats
-* @params Mat input image to preprocess
-* @return Mat binary image
-*/
-Mat preprocessImage(Mat input) {
-    if (input.channels() == 3)
-        cvtColor(input, input, COLOR_RGB2GRAY);
-    Mat result;
-    // Remove noise
-    Mat img_noise, img_box_smooth;
-    medianBlur(input, img_noise, 3);
-
-    //Apply the light pattern
-    Mat img_no_light;
-    img_noise.copyTo(img_no_light);
-    img_no_light = removeLight(img_noise, light_pattern);
-
-    // Binarize image for segment
-    threshold(img_no_light, result, 30, 255, THRESH_BINARY);
-
-    return result;
-}
-
-/**
-* Read all images in a folder creating the train and test vectors
-* @param folder string name
-* @param label assigned to train and test data
-* @param number of images used for test and evaluate algorithm error
-* @param trainingData vector where store all features for training
-* @param reponsesData vector where store all labels corresopinding for training data, in this case the label values
-* @param testData vector where store all features for test, this vector as the num_for_test size
-* @param testResponsesData vector where store all labels corresponiding for test, has the num_for_test size with label values
-* @return true if can read the folder images, false in error case
-**/
-bool readFolderAndExtractFeatures(string folder, int label, int num_for_test,
-                                  vector<float> &trainingData, vector<int> &responsesData,
-                                  vector<float> &testData, vector<float> &testResponsesData) {
-    VideoCapture images;
-    if (images.open(folder) == false) {
-        cout << "Can not open the folder images" << endl;
-        return false;
-    }
-    Mat frame;
-    int img_index = 0;
-    while (images.read(frame)) {
-        //// Preprocess image
-        Mat pre = preprocessImage(frame);
-        // Extract features
-        vector<vector<float> > features = ExtractFeatures(pre);
-        for (int i = 0; i < features.size(); i++) {
-            if (img_index >= num_for_test) {
-                trainingData.push_back(features[i][0]);
-                trainingData.push_back(features[i][1]);
-                responsesData.push_back(label);
-            } else {
-                testData.push_back(features[i][0]);
-                testData.push_back(features[i][1]);
-                testResponsesData.push_back((float) label);
-            }
-        }
-        img_index++;
-    }
-    return true;
-}
-
 void trainAndTest() {
     // 储存训练和测试数据的变量
-    vector<float> trainingData;
+    PartFeatures trainingData;
     vector<int> responsesData;
-    vector<float> testData;
+    PartFeatures testData;
     vector<float> testResponsesData;
 
-    int num_for_test = 20;
-
-    // readFolderAndExtractFeatures 使用OpenCv 的VideoCaptrue 函数读取文件夹中的所有图像，包括视频和相见的帧
-    // Get the nut images
-    readFolderAndExtractFeatures("../data/nut/tuerca_%04d.pgm", 0, num_for_test, trainingData, responsesData,
-                                 testData, testResponsesData);
-    // Get and process the ring images
-    readFolderAndExtractFeatures("../data/ring/arandela_%04d.pgm", 1, num_for_test, trainingData, responsesData,
-                                 testData, testResponsesData);
-    // get and process the screw images
-    readFolderAndExtractFeatures("../data/screw/tornillo_%04d.pgm", 2, num_for_test, trainingData, responsesData,
-                                 testData, testResponsesData);
+    // 读取所有文件夹中的所有图像，并行提取特征
+    readPartsDataset(light_pattern, feature_cache_file, trainingData, responsesData,
+                     testData, testResponsesData);
 
     cout << "Num of train samples: " << responsesData.size() << endl;
 
     cout << "Num of test samples: " << testResponsesData.size() << endl;
 
     // Merge all data
-    // 把向量转化为Mat格式
-    Mat trainingDataMat(trainingData.size() / 2, 2, CV_32FC1, &trainingData[0]);
+    // 特征表直接作为Mat使用，不复制数据
+    Mat trainingDataMat = trainingData.mat();
     Mat responses(responsesData.size(), 1, CV_32SC1, &responsesData[0]);
 
-    Mat testDataMat(testData.size() / 2, 2, CV_32FC1, &testData[0]);
+    Mat testDataMat = testData.mat();
     Mat testResponses(testResponsesData.size(), 1, CV_32FC1, &testResponsesData[0]);
 
-    Ptr<TrainData> tdata = TrainData::create(trainingDataMat, ROW_SAMPLE, responses);
-
-    // 创建和训练模型
-    svm = cv::ml::SVM::create();
-    svm->setType(cv::ml::SVM::C_SVC);
-    svm->setNu(0.05);
-    svm->setKernel(cv::ml::SVM::CHI2);
-    svm->setDegree(1.0);
-    svm->setGamma(2.0);
-    svm->setTermCriteria(TermCriteria(TermCriteria::MAX_ITER, 100, 1e-6));
-    // 训练SVM模型
-    svm->train(tdata);
+    // 创建和训练模型, 线性SVM使用映射后的特征，预测只需要点积
+    classifier.train(classifier.createSVM(), trainingDataMat, responses);
 
     if (testResponsesData.size() > 0) {
         cout << "Evaluation" << endl;
         cout << "==========" << endl;
         // Test the ML Model
         Mat testPredict;
-        svm->predict(testDataMat, testPredict);
-        cout << "Prediction Done" << endl;
+        int64 predict_start = getTickCount();
+        classifier.predict(testDataMat, testPredict);
+        double predict_time = (getTickCount() - predict_start) * 1e6 / getTickFrequency();
+        cout << "Prediction Done in " << predict_time / testDataMat.rows << " us/sample" << endl;
         // Error calculation
         Mat errorMat = testPredict != testResponses;
         float error = 100.0f * countNonZero(errorMat) / testResponsesData.size();
@@ -424,3 +295,71 @@ void trainAndTest() {
         plotTrainData(trainingDataMat, responses);
     }
 }
+
+/**
+* Measure the time to extract the features of an image, and the time to
+* classify all the parts of a tray with one prediction, for trays from 10 to
+* 1000 parts built repeating the extracted objects
+* @param pre Mat binary image, empty if the image was processed in strips
+* @param samples Mat with a row of features for each object of the image
+**/
+void benchmarkPrediction(Mat img, Mat pre, Mat samples, int strip_rows) {
+    if (samples.rows == 0)
+        return;
+    if (pre.empty())
+        pre = preprocessImage(img, light_pattern);
+    const int repetitions = 50;
+    // Mat buffers allocated by each preprocessed image, with new buffers for
+    // each image and reusing a workspace sized by a first image
+    AllocationCounter::install();
+    PreprocessWorkspace ws;
+    preprocessImage(img, light_pattern, ws);
+    uint64_t allocations = AllocationCounter::count();
+    int64 preprocess_start = getTickCount();
+    for (int r = 0; r < repetitions; r++)
+        preprocessImage(img, light_pattern);
+    double preprocess_ms = (getTickCount() - preprocess_start) * 1000.0 / getTickFrequency() / repetitions;
+    double preprocess_allocations = (double) (AllocationCounter::count() - allocations) / repetitions;
+    allocations = AllocationCounter::count();
+    preprocess_start = getTickCount();
+    for (int r = 0; r < repetitions; r++)
+        preprocessImage(img, light_pattern, ws);
+    double workspace_ms = (getTickCount() - preprocess_start) * 1000.0 / getTickFrequency() / repetitions;
+    double workspace_allocations = (double) (AllocationCounter::count() - allocations) / repetitions;
+    cout << "Preprocessing: " << preprocess_ms << " ms/frame, " << preprocess_allocations
+         << " allocations/frame; with workspace: " << workspace_ms << " ms/frame, " << workspace_allocations
+         << " allocations/frame" << endl;
+    int64 extract_start = getTickCount();
+    for (int r = 0; r < repetitions; r++)
+        ExtractFeatures(pre);
+    cout << "Feature extraction: " << (getTickCount() - extract_start) * 1000.0 / getTickFrequency() / repetitions
+         << " ms/frame, " << num_features << " features" << endl;
+    if (strip_rows > 0) {
+        // Preprocessing and extraction of the whole image against the strips
+        int64 whole_start = getTickCount();
+        for (int r = 0; r < repetitions; r++)
+            ExtractFeatures(preprocessImage(img, light_pattern, ws));
+        double whole_ms = (getTickCount() - whole_start) * 1000.0 / getTickFrequency() / repetitions;
+        int64 strips_start = getTickCount();
+        int strip_objects = 0;
+        for (int r = 0; r < repetitions; r++)
+            strip_objects = ExtractFeaturesInStrips(img, light_pattern, strip_rows).size();
+        double strips_ms = (getTickCount() - strips_start) * 1000.0 / getTickFrequency() / repetitions;
+        cout << "Preprocessing and extraction: whole image " << whole_ms << " ms/frame, " << samples.rows
+             << " objects; strips of " << strip_rows << " rows " << strips_ms << " ms/frame, " << strip_objects
+             << " objects" << endl;
+    }
+    int tray_sizes[] = {10, 30, 100, 300, 1000};
+    cout << "Parts\tms/frame\tus/part" << endl;
+    for (int t = 0; t < sizeof(tray_sizes) / sizeof(tray_sizes[0]); t++) {
+        Mat tray(tray_sizes[t], samples.cols, CV_32FC1);
+        for (int i = 0; i < tray.rows; i++)
+            samples.row(i % samples.rows).copyTo(tray.row(i));
+        Mat results;
+        int64 start = getTickCount();
+        for (int r = 0; r < repetitions; r++)
+            classifier.predict(tray, results);
+        double ms = (getTickCount() - start) * 1000.0 / getTickFrequency() / repetitions;
+        cout << tray.rows << "\t" << ms << "\t" << ms * 1000.0 / tray.rows << endl;
+    }
+}
@@ -0,0 +1,423 @@
+// PARTS CLASSIFICATION DAEMON
+// Keep the light pattern and the trained model in memory and classify the
+// images received through a Unix domain socket or dropped in a spool folder,
+// replying with the label and position of each object and keeping the
+// p50/p95/p99 latency of the requests
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <dirent.h>
+#include <unistd.h>
+
+using namespace std;
+
+// OpenCV includes
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/ml.hpp>
+
+#include "utils/PartsDataset.h"
+#include "utils/PartsClassifier.h"
+#include "utils/StripExtractor.h"
+#include "utils/IncrementalLearner.h"
+
+using namespace cv;
+using namespace cv::ml;
+
+const char *keys =
+        {
+                "{help h usage ? | | print this message}"
+                "{@pattern | ../data/pattern.pgm | Light pattern image}"
+                "{socket || Unix domain socket where listen for image paths}"
+                "{spool || Folder watched for new images, they are moved with their results to its done subfolder}"
+                "{model || Trained model file, it is loaded if it matches the training set, else trained and saved}"
+                "{cache | features.cache | File where store the training features, empty to disable the cache}"
+                "{linear | | Use a linear SVM over an explicit chi-squared feature map instead of the CHI2 kernel}"
+                "{threads | -1 | Number of threads used to extract the training features, -1 uses all the cores}"
+                "{stats_every | 100 | Print the latency percentiles every N requests, 0 disables it}"
+                "{strips | 0 | Extract the features of the images in parallel strips of N rows, 0 processes the whole image}"
+                "{online || Snapshot file of an incremental model that learns the corrections sent with LEARN}"
+                "{snapshot_every | 100 | Save the incremental model every N corrections}"
+        };
+
+const char *part_names[] = {"NUT", "RING", "SCREW"};
+const int num_part_names = sizeof(part_names) / sizeof(part_names[0]);
+
+static volatile sig_atomic_t running = 1;
+
+static void stopHandler(int) {
+    running = 0;
+}
+
+/**
+ * Latency of the last requests, the percentiles are computed over a window
+ * of the most recent samples so a long running daemon reports its current
+ * behaviour with bounded memory
+ */
+class LatencyStats {
+public:
+    LatencyStats(size_t window = 10000) : window(window), next(0), count(0) {}
+
+    void add(double us) {
+        if (samples.size() < window) {
+            samples.push_back(us);
+        } else {
+            samples[next] = us;
+            next = (next + 1) % window;
+        }
+        count++;
+    }
+
+    double percentile(double p) const {
+        if (samples.empty())
+            return 0;
+        vector<double> sorted(samples);
+        size_t n = min(sorted.size() - 1, (size_t) (p * sorted.size() / 100.0));
+        nth_element(sorted.begin(), sorted.begin() + n, sorted.end());
+        return sorted[n];
+    }
+
+    string report() const {
+        return format("requests=%llu p50_us=%.1f p95_us=%.1f p99_us=%.1f", (unsigned long long) count,
+                      percentile(50), percentile(95), percentile(99));
+    }
+
+private:
+    size_t window;
+    size_t next;
+    uint64 count;
+    vector<double> samples;
+};
+
+Mat light_pattern;
+PartsClassifier classifier;
+LatencyStats latency;
+int strip_rows = 0;
+// Incremental model used instead of the SVM when online learning is enabled
+IncrementalLearner learner;
+bool online = false;
+// Features of the last image classified, the objects corrected with LEARN
+PartFeatures last_features;
+
+/**
+ * Load the model or train it with the parts dataset, as the Chapter 6 application does.
+ * The incremental model is loaded from its last snapshot if it exists
+ */
+static bool prepareModel(string model_file, string cache_file, string online_file) {
+    // Both models are trained again if the training set or the preprocessing changed
+    uint64_t training_hash = 0;
+    if (online || !model_file.empty())
+        training_hash = trainingSetHash(light_pattern);
+    if (online) {
+        if (learner.load(online_file, training_hash)) {
+            cout << "Incremental model loaded from " << online_file << ", " << learner.steps() << " steps" << endl;
+            return true;
+        }
+    } else if (!model_file.empty()) {
+        if (classifier.load(model_file, training_hash))
+            return true;
+    }
+    PartFeatures trainingData, testData;
+    vector<int> responsesData;
+    vector<float> testResponsesData;
+    if (!readPartsDataset(light_pattern, cache_file, trainingData, responsesData, testData, testResponsesData))
+        return false;
+    Mat samples = trainingData.mat();
+    if (samples.empty()) {
+        cout << "ERROR: Not train samples" << endl;
+        return false;
+    }
+    Mat responses(responsesData.size(), 1, CV_32SC1, &responsesData[0]);
+    if (online) {
+        learner.init(samples, responses, training_hash);
+        if (!learner.save(online_file))
+            cout << "Can not save the incremental model " << online_file << endl;
+        return true;
+    }
+    classifier.train(classifier.createSVM(), samples, responses);
+    if (!model_file.empty() && !classifier.save(model_file, training_hash))
+        cout << "Can not save the model " << model_file << endl;
+    return true;
+}
+
+/**
+ * Classify the objects of an image
+ * @param string path image file
+ * @return string reply line, OK followed by the number of objects and the
+ * label name, label, x and y of each one, or ERR and the reason
+ */
+static string classifyImage(const string &path) {
+    int64 start = getTickCount();
+    Mat img = imread(path, IMREAD_GRAYSCALE);
+    if (img.empty())
+        return "ERR can not read " + path;
+    vector<int> pos_left, pos_top;
+    PartFeatures features;
+    if (strip_rows > 0) {
+        features = ExtractFeaturesInStrips(img, light_pattern, strip_rows, &pos_left, &pos_top);
+    } else {
+        // The buffers of the workspace are reused by every request
+        Mat pre = preprocessImage(img, light_pattern, threadWorkspace());
+        features = ExtractFeatures(pre, &pos_left, &pos_top);
+    }
+    Mat results;
+    if (!features.empty()) {
+        if (online)
+            learner.predict(features.mat(), results);
+        else
+            classifier.predict(features.mat(), results);
+    }
+    last_features = features;
+
+    ostringstream reply;
+    reply << "OK " << results.rows;
+    for (int i = 0; i < results.rows; i++) {
+        int label = (int) results.at<float>(i);
+        reply << " " << (label >= 0 && label < num_part_names ? part_names[label] : "UNKNOWN")
+              << " " << label << " " << pos_left[i] << " " << pos_top[i];
+    }
+    latency.add((getTickCount() - start) * 1e6 / getTickFrequency());
+    return reply.str();
+}
+
+static void printStats(int stats_every) {
+    static uint64 requests = 0;
+    requests++;
+    if (stats_every > 0 && requests % stats_every == 0)
+        cout << latency.report() << endl;
+}
+
+/**
+ * Learn the right label of an object of the last image classified
+ * @param string arguments index of the object in the last reply and its label
+ * @return string reply line
+ */
+static string learnCorrection(const string &arguments) {
+    if (!online)
+        return "ERR online learning is disabled";
+    int index, label;
+    istringstream in(arguments);
+    if (!(in >> index >> label) || index < 0 || index >= last_features.size())
+        return "ERR usage: LEARN <object index in the last reply> <label>";
+    // Only the labels of the known parts, a new label would add a class to the model
+    if (label < 0 || label >= num_part_names)
+        return format("ERR the label must be from 0 to %d", num_part_names - 1);
+    int64 start = getTickCount();
+    learner.addSample(last_features.row(index), label);
+    learner.updateModel();
+    double us = (getTickCount() - start) * 1e6 / getTickFrequency();
+    return format("OK steps=%llu update_us=%.1f", (unsigned long long) learner.steps(), us);
+}
+
+/**
+ * Answer a line of a client: an image path, LEARN, STATS or QUIT
+ * @return bool false if the client closes the connection
+ */
+static bool handleLine(int client, const string &line, int stats_every) {
+    string reply;
+    if (line == "QUIT")
+        return false;
+    if (line == "STATS") {
+        reply = "STATS " + latency.report();
+    } else if (line.compare(0, 6, "LEARN ") == 0) {
+        reply = learnCorrection(line.substr(6));
+    } else if (!line.empty()) {
+        reply = classifyImage(line);
+        printStats(stats_every);
+    }
+    reply += "\n";
+    // SIGPIPE is ignored, a closed client makes send fail instead of killing the daemon
+    return send(client, reply.data(), reply.size(), 0) == (ssize_t) reply.size();
+}
+
+/**
+ * Listen in a Unix domain socket, each client sends one request per line and
+ * receives one line per request. Clients are served one after another, the
+ * model is not shared between threads
+ */
+static int serveSocket(string socket_path, int stats_every) {
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0) {
+        cout << "ERROR: Can not create the socket: " << strerror(errno) << endl;
+        return -1;
+    }
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        cout << "ERROR: Socket path too long " << socket_path << endl;
+        close(server);
+        return -1;
+    }
+    strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(socket_path.c_str());
+    if (bind(server, (sockaddr *) &addr, sizeof(addr)) != 0 || listen(server, 8) != 0) {
+        cout << "ERROR: Can not listen in " << socket_path << ": " << strerror(errno) << endl;
+        close(server);
+        return -1;
+    }
+    cout << "Listening in " << socket_path << endl;
+
+    while (running) {
+        int client = accept(server, NULL, NULL);
+        if (client < 0)
+            continue;
+        // Corrections only apply to the images of the same client
+        last_features.clear();
+        string pending;
+        char buffer[4096];
+        bool open = true;
+        while (running && open) {
+            ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+            if (n <= 0)
+                break;
+            pending.append(buffer, n);
+            size_t end;
+            while (open && (end = pending.find('\n')) != string::npos) {
+                string line = pending.substr(0, end);
+                if (!line.empty() && line[line.size() - 1] == '\r')
+                    line.erase(line.size() - 1);
+                pending.erase(0, end + 1);
+                open = handleLine(client, line, stats_every);
+            }
+        }
+        close(client);
+    }
+    close(server);
+    unlink(socket_path.c_str());
+    return 0;
+}
+
+static bool isImageFile(const string &name) {
+    const char *extensions[] = {".pgm", ".png", ".jpg", ".jpeg", ".bmp", ".tif", ".tiff"};
+    for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++) {
+        string ext = extensions[i];
+        if (name.size() > ext.size() && name.compare(name.size() - ext.size(), ext.size(), ext) == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Watch a folder for new images, each image gets a name.txt file with the
+ * reply and is moved to the done subfolder, the latency percentiles are kept
+ * in stats.txt. Hidden files are skipped, and an image is only classified
+ * when its size and modification time did not change since the previous
+ * scan, so images still being written by a producer are left for later
+ */
+static int serveSpool(string spool, int stats_every) {
+    string done = spool + "/done";
+    mkdir(done.c_str(), 0755);
+    cout << "Watching " << spool << endl;
+    // Size and modification time of each image in the previous scan
+    map<string, pair<off_t, time_t> > seen;
+    while (running) {
+        DIR *dir = opendir(spool.c_str());
+        if (dir == NULL) {
+            cout << "ERROR: Can not open the spool folder " << spool << endl;
+            return -1;
+        }
+        vector<string> names;
+        map<string, pair<off_t, time_t> > current;
+        for (dirent *entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+            string name = entry->d_name;
+            struct stat info;
+            if (name[0] == '.' || !isImageFile(name) || stat((spool + "/" + name).c_str(), &info) != 0)
+                continue;
+            current[name] = make_pair(info.st_size, info.st_mtime);
+            auto previous = seen.find(name);
+            if (previous != seen.end() && previous->second == current[name])
+                names.push_back(name);
+        }
+        closedir(dir);
+        seen.swap(current);
+        // Oldest names first, producers usually name the images in sequence
+        sort(names.begin(), names.end());
+        for (size_t i = 0; i < names.size() && running; i++) {
+            string path = spool + "/" + names[i];
+            string reply = classifyImage(path);
+            // Write the result and then publish it, readers never see partial files
+            string result = done + "/" + names[i] + ".txt";
+            ofstream(result + ".tmp") << reply << endl;
+            rename((result + ".tmp").c_str(), result.c_str());
+            rename(path.c_str(), (done + "/" + names[i]).c_str());
+            ofstream(spool + "/stats.txt") << latency.report() << endl;
+            printStats(stats_every);
+        }
+        // Scans at least 50 ms apart, an image must keep its size and time between them
+        this_thread::sleep_for(chrono::milliseconds(50));
+    }
+    return 0;
+}
+
+int main(int argc, const char **argv) {
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 6. Classification daemon v1.0.0");
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+    String light_pattern_file = parser.get<String>(0);
+    String socket_path = parser.get<String>("socket");
+    String spool = parser.get<String>("spool");
+    String model_file = parser.get<String>("model");
+    String cache_file = parser.get<String>("cache");
+    int num_threads = parser.get<int>("threads");
+    int stats_every = parser.get<int>("stats_every");
+    strip_rows = parser.get<int>("strips");
+    String online_file = parser.get<String>("online");
+    int snapshot_every = parser.get<int>("snapshot_every");
+    online = !online_file.empty();
+    classifier = PartsClassifier(parser.has("linear"));
+    if (!parser.check()) {
+        parser.printErrors();
+        return 0;
+    }
+    if (socket_path.empty() == spool.empty()) {
+        cout << "ERROR: Use either --socket or --spool" << endl;
+        return -1;
+    }
+    setNumThreads(num_threads);
+
+    int64 start = getTickCount();
+    light_pattern = loadLightPattern(light_pattern_file);
+    if (light_pattern.empty()) {
+        cout << "ERROR: Not light patter loaded" << endl;
+        return -1;
+    }
+    if (!prepareModel(model_file, cache_file, online_file))
+        return -1;
+    if (online)
+        learner.setSnapshot(online_file, snapshot_every);
+    cout << "Model ready in " << (getTickCount() - start) * 1000.0 / getTickFrequency() << " ms" << endl;
+
+    // Stop on Ctrl+C or kill, without restarting the blocking calls
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stopHandler;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    // A client that closes its socket must not kill the daemon when it replies
+    signal(SIGPIPE, SIG_IGN);
+
+    int ret = socket_path.empty() ? serveSpool(spool, stats_every) : serveSocket(socket_path, stats_every);
+    cout << latency.report() << endl;
+    if (online && !learner.save(online_file))
+        cout << "Can not save the incremental model " << online_file << endl;
+    return ret;
+}
@@ -0,0 +1,317 @@
+// SVM HYPERPARAMETER SEARCH
+// Evaluate a grid or a random set of kernel, C and gamma values with k-fold
+// cross validation over the training features of the parts dataset, all the
+// fold trainings run in parallel, and save the best model for Chapter 6
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cmath>
+
+using namespace std;
+
+// OpenCV includes
+#include <opencv2/core.hpp>
+#include <opencv2/ml.hpp>
+
+#include "utils/PartsDataset.h"
+#include "utils/PartsClassifier.h"
+
+using namespace cv;
+using namespace cv::ml;
+
+const char *keys =
+        {
+                "{help h usage ? | | print this message}"
+                "{@pattern | ../data/pattern.pgm | Light pattern image}"
+                "{cache | features.cache | File where store the training features, empty to disable the cache}"
+                "{threads | -1 | Number of threads used to train the folds, -1 uses all the cores}"
+                "{folds | 5 | Number of cross validation folds}"
+                "{random | 0 | Number of random candidates, 0 evaluates the whole grid}"
+                "{seed | 12345 | Seed of the random candidates}"
+                "{linear | | Search the linear SVM over the chi-squared feature map}"
+                "{model | parts_svm.yml | File where save the best model, loaded by Chapter6 --model}"
+                "{log | svm_search.csv | File where write the error of each candidate and fold}"
+                "{report | svm_search.txt | File where write the timing report}"
+        };
+
+/**
+ * SVM parameters to evaluate
+ */
+struct SearchCandidate {
+    int kernel;
+    double C;
+    double gamma;
+    // Errors and training time of each fold
+    vector<int> fold_errors;
+    vector<double> fold_ms;
+    double mean_error;
+};
+
+static const char *kernelName(int kernel) {
+    switch (kernel) {
+        case SVM::LINEAR:
+            return "LINEAR";
+        case SVM::RBF:
+            return "RBF";
+        case SVM::CHI2:
+            return "CHI2";
+        default:
+            return "OTHER";
+    }
+}
+
+/**
+ * Grid of log spaced C and gamma values for each kernel, the gamma is not
+ * used by the LINEAR kernel
+ */
+static vector<SearchCandidate> gridCandidates(const vector<int> &kernels) {
+    const double C_values[] = {0.1, 1, 10, 100, 1000};
+    const double gamma_values[] = {0.01, 0.1, 0.5, 2, 8};
+    vector<SearchCandidate> candidates;
+    for (size_t k = 0; k < kernels.size(); k++) {
+        int num_gamma = kernels[k] == SVM::LINEAR ? 1 : 5;
+        for (int c = 0; c < 5; c++) {
+            for (int g = 0; g < num_gamma; g++) {
+                SearchCandidate candidate = SearchCandidate();
+                candidate.kernel = kernels[k];
+                candidate.C = C_values[c];
+                candidate.gamma = kernels[k] == SVM::LINEAR ? 1 : gamma_values[g];
+                candidates.push_back(candidate);
+            }
+        }
+    }
+    return candidates;
+}
+
+/**
+ * Random candidates with C and gamma log uniform in the range of the grid
+ */
+static vector<SearchCandidate> randomCandidates(const vector<int> &kernels, int count, uint64 seed) {
+    RNG rng(seed);
+    vector<SearchCandidate> candidates;
+    for (int i = 0; i < count; i++) {
+        SearchCandidate candidate = SearchCandidate();
+        candidate.kernel = kernels[rng.uniform(0, (int) kernels.size())];
+        candidate.C = pow(10.0, rng.uniform(-1.0, 3.0));
+        candidate.gamma = candidate.kernel == SVM::LINEAR ? 1 : pow(10.0, rng.uniform(-2.0, 1.0));
+        candidates.push_back(candidate);
+    }
+    return candidates;
+}
+
+/**
+ * Stratified folds, the n-th sample of each class goes to the fold n % k so
+ * all folds have the same proportion of each class and the split does not
+ * depend on the number of threads
+ */
+static vector<int> stratifiedFolds(const vector<int> &labels, int k) {
+    vector<int> folds(labels.size());
+    vector<int> seen;
+    for (size_t i = 0; i < labels.size(); i++) {
+        if (labels[i] >= (int) seen.size())
+            seen.resize(labels[i] + 1, 0);
+        folds[i] = seen[labels[i]]++ % k;
+    }
+    return folds;
+}
+
+/**
+ * Copy the rows of the samples that belong (or not) to a fold
+ */
+static void splitFold(Mat samples, const vector<int> &labels, const vector<int> &folds, int fold, bool in_fold,
+                      Mat &fold_samples, Mat &fold_labels) {
+    fold_samples.release();
+    vector<int> fold_labels_data;
+    for (size_t i = 0; i < folds.size(); i++) {
+        if ((folds[i] == fold) != in_fold)
+            continue;
+        fold_samples.push_back(samples.row((int) i));
+        fold_labels_data.push_back(labels[i]);
+    }
+    Mat(fold_labels_data, true).copyTo(fold_labels);
+}
+
+/**
+ * Chapter 6 SVM with the parameters of a candidate
+ */
+static Ptr<SVM> candidateSVM(const PartsClassifier &classifier, const SearchCandidate &candidate) {
+    Ptr<SVM> svm = classifier.createSVM();
+    svm->setKernel(candidate.kernel);
+    svm->setC(candidate.C);
+    svm->setGamma(candidate.gamma);
+    return svm;
+}
+
+static int countErrors(Mat results, Mat labels) {
+    int errors = 0;
+    for (int i = 0; i < results.rows; i++) {
+        if ((int) results.at<float>(i) != labels.at<int>(i))
+            errors++;
+    }
+    return errors;
+}
+
+int main(int argc, const char **argv) {
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 6. SVM hyperparameter search v1.0.0");
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+    String light_pattern_file = parser.get<String>(0);
+    String cache_file = parser.get<String>("cache");
+    int num_threads = parser.get<int>("threads");
+    int k = parser.get<int>("folds");
+    int num_random = parser.get<int>("random");
+    uint64 seed = (uint64) parser.get<double>("seed");
+    bool use_feature_map = parser.has("linear");
+    String model_file = parser.get<String>("model");
+    String log_file = parser.get<String>("log");
+    String report_file = parser.get<String>("report");
+    if (!parser.check()) {
+        parser.printErrors();
+        return 0;
+    }
+    if (k < 2) {
+        cout << "ERROR: At least 2 folds are required" << endl;
+        return -1;
+    }
+    setNumThreads(num_threads);
+
+    Mat light_pattern = loadLightPattern(light_pattern_file);
+    if (light_pattern.empty()) {
+        cout << "ERROR: Not light patter loaded" << endl;
+        return -1;
+    }
+
+    // Same features, train and test data as the Chapter 6 application
+    PartFeatures trainingData, testData;
+    vector<int> responsesData;
+    vector<float> testResponsesData;
+    if (!readPartsDataset(light_pattern, cache_file, trainingData, responsesData, testData, testResponsesData))
+        return -1;
+    Mat samples = trainingData.mat();
+    Mat testSamples = testData.mat();
+    if (samples.rows < k || testSamples.empty()) {
+        cout << "ERROR: Not enough train and test samples" << endl;
+        return -1;
+    }
+
+    // The linear SVM over the feature map only has the C parameter
+    vector<int> kernels;
+    if (use_feature_map) {
+        kernels.push_back(SVM::LINEAR);
+    } else {
+        kernels.push_back(SVM::CHI2);
+        kernels.push_back(SVM::RBF);
+    }
+    vector<SearchCandidate> candidates = num_random > 0 ? randomCandidates(kernels, num_random, seed)
+                                                        : gridCandidates(kernels);
+    for (size_t c = 0; c < candidates.size(); c++) {
+        candidates[c].fold_errors.resize(k);
+        candidates[c].fold_ms.resize(k);
+    }
+
+    // Split the training set once, every candidate uses the same folds
+    vector<int> folds = stratifiedFolds(responsesData, k);
+    vector<Mat> train_samples(k), train_labels(k), val_samples(k), val_labels(k);
+    for (int f = 0; f < k; f++) {
+        splitFold(samples, responsesData, folds, f, false, train_samples[f], train_labels[f]);
+        splitFold(samples, responsesData, folds, f, true, val_samples[f], val_labels[f]);
+    }
+
+    cout << "Train samples: " << samples.rows << ", test samples: " << testSamples.rows
+         << ", candidates: " << candidates.size() << ", folds: " << k
+         << ", threads: " << getNumThreads() << endl;
+
+    // Each task trains a candidate on a fold and writes its own slot
+    int num_tasks = (int) candidates.size() * k;
+    int64 search_start = getTickCount();
+    parallel_for_(Range(0, num_tasks), [&](const Range &range) {
+        for (int t = range.start; t < range.end; t++) {
+            SearchCandidate &candidate = candidates[t / k];
+            int f = t % k;
+            int64 start = getTickCount();
+            PartsClassifier fold_classifier(use_feature_map);
+            fold_classifier.train(candidateSVM(fold_classifier, candidate), train_samples[f], train_labels[f]);
+            Mat results;
+            fold_classifier.predict(val_samples[f], results);
+            candidate.fold_errors[f] = countErrors(results, val_labels[f]);
+            candidate.fold_ms[f] = (getTickCount() - start) * 1000.0 / getTickFrequency();
+        }
+    });
+    double search_ms = (getTickCount() - search_start) * 1000.0 / getTickFrequency();
+
+    // Lowest mean error wins, the first candidate in case of a tie
+    size_t best = 0;
+    double task_ms = 0;
+    for (size_t c = 0; c < candidates.size(); c++) {
+        int errors = 0;
+        for (int f = 0; f < k; f++) {
+            errors += candidates[c].fold_errors[f];
+            task_ms += candidates[c].fold_ms[f];
+        }
+        candidates[c].mean_error = 100.0 * errors / samples.rows;
+        if (candidates[c].mean_error < candidates[best].mean_error)
+            best = c;
+    }
+
+    if (!log_file.empty()) {
+        ofstream log(log_file.c_str());
+        log << "kernel,C,gamma,fold,errors,samples,train_ms,mean_error" << endl;
+        for (size_t c = 0; c < candidates.size(); c++) {
+            for (int f = 0; f < k; f++) {
+                log << kernelName(candidates[c].kernel) << "," << candidates[c].C << "," << candidates[c].gamma
+                    << "," << f << "," << candidates[c].fold_errors[f] << "," << val_samples[f].rows
+                    << "," << candidates[c].fold_ms[f] << "," << candidates[c].mean_error << endl;
+            }
+        }
+    }
+
+    // Train the best candidate with all the training set and test it
+    const SearchCandidate &winner = candidates[best];
+    Mat responses(responsesData.size(), 1, CV_32SC1, &responsesData[0]);
+    PartsClassifier classifier(use_feature_map);
+    classifier.train(candidateSVM(classifier, winner), samples, responses);
+    Mat testResults;
+    classifier.predict(testSamples, testResults);
+    int test_errors = 0;
+    for (int i = 0; i < testResults.rows; i++) {
+        if (testResults.at<float>(i) != testResponsesData[i])
+            test_errors++;
+    }
+    double test_error = 100.0 * test_errors / testSamples.rows;
+
+    cout << fixed << setprecision(2);
+    cout << "Best: " << kernelName(winner.kernel) << " C=" << winner.C << " gamma=" << winner.gamma
+         << ", cross validation error: " << winner.mean_error << "%, test error: " << test_error << "%" << endl;
+    cout << "Search time: " << search_ms << " ms, sum of the fold trainings: " << task_ms
+         << " ms, speedup: " << task_ms / search_ms << endl;
+
+    if (!report_file.empty()) {
+        ofstream report(report_file.c_str());
+        report << fixed << setprecision(2);
+        report << "threads: " << getNumThreads() << endl;
+        report << "candidates: " << candidates.size() << endl;
+        report << "folds: " << k << endl;
+        report << "trainings: " << num_tasks << endl;
+        report << "wall_ms: " << search_ms << endl;
+        report << "sum_train_ms: " << task_ms << endl;
+        report << "speedup: " << task_ms / search_ms << endl;
+        report << "best: " << kernelName(winner.kernel) << " C=" << winner.C << " gamma=" << winner.gamma << endl;
+        report << "cv_error: " << winner.mean_error << endl;
+        report << "test_error: " << test_error << endl;
+    }
+
+    // Same model file format and training set hash used by Chapter6 --model
+    if (!model_file.empty()) {
+        if (classifier.save(model_file, trainingSetHash(light_pattern)))
+            cout << "Model saved in " << model_file << endl;
+        else
+            cout << "ERROR: Can not save the model " << model_file << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+
+// OpenCV includes
+#include "opencv2/core.hpp"
+using namespace cv;
+
+namespace {
+
+std::atomic<uint64_t> allocations(0);
+
+// The access flags of MatAllocator are an int before OpenCV 4.1
+#if CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR < 1
+typedef int AllocatorAccessFlag;
+#else
+typedef AccessFlag AllocatorAccessFlag;
+#endif
+
+/**
+ * Forward everything to the allocator that was the default one, counting
+ * the buffers it creates
+ */
+class CountingAllocator : public MatAllocator
+{
+    public:
+        CountingAllocator(MatAllocator *base): base(base) {}
+
+        UMatData* allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                           AllocatorAccessFlag flags, UMatUsageFlags usageFlags) const CV_OVERRIDE
+        {
+            // Headers of user data do not allocate a buffer
+            if(data==NULL)
+                allocations++;
+            return this->base->allocate(dims, sizes, type, data, step, flags, usageFlags);
+        }
+
+        bool allocate(UMatData *data, AllocatorAccessFlag accessflags, UMatUsageFlags usageFlags) const CV_OVERRIDE
+        {
+            return this->base->allocate(data, accessflags, usageFlags);
+        }
+
+        void deallocate(UMatData *data) const CV_OVERRIDE
+        {
+            this->base->deallocate(data);
+        }
+
+    private:
+        MatAllocator *base;
+};
+
+}
+
+void AllocationCounter::install()
+{
+    static CountingAllocator *counter= NULL;
+    if(counter!=NULL)
+        return;
+    counter= new CountingAllocator(Mat::getDefaultAllocator());
+    Mat::setDefaultAllocator(counter);
+}
+
+uint64_t AllocationCounter::count()
+{
+    return allocations;
+}
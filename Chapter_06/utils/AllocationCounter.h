@@ -0,0 +1,32 @@
+/**
+ * Allocation Counter
+ *
+ * Count the Mat buffers allocated on the heap, used to check that the code
+ * reusing its buffers does not allocate memory once they are sized. The
+ * counter wraps the default OpenCV allocator, it is installed once and the
+ * Mats allocated before keep working with the previous allocator.
+ *
+ */
+
+#ifndef ALLOCATION_COUNTER_h
+#define ALLOCATION_COUNTER_h
+
+#include <stdint.h>
+
+class AllocationCounter
+{
+    public:
+        /**
+         * Make the counter the default allocator of the new Mats, only the
+         * first call installs it
+         */
+        static void install();
+
+        /**
+         * Number of Mat buffers allocated since the counter was installed
+         */
+        static uint64_t count();
+};
+
+
+#endif
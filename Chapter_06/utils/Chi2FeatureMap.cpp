@@ -0,0 +1,85 @@
+#include "Chi2FeatureMap.h"
+
+#include <cmath>
+
+Chi2FeatureMap::Chi2FeatureMap(int order, double period)
+{
+    this->order= order;
+    this->period= period;
+    this->computeSpectrum();
+}
+
+void Chi2FeatureMap::computeSpectrum()
+{
+    // Spectrum of the chi-squared kernel, kappa(lambda) = sech(pi * lambda),
+    // sampled at j * period. Frequencies over 0 are used twice, cos and sin
+    this->spectrum.resize(this->order+1);
+    for(int j=0; j<=this->order; j++){
+        double kappa= 1.0/cosh(CV_PI*j*this->period);
+        this->spectrum[j]= (float)sqrt((j==0?1.0:2.0)*this->period*kappa);
+    }
+}
+
+void Chi2FeatureMap::fit(Mat samples)
+{
+    this->offset.assign(samples.cols, 0);
+    this->scale.assign(samples.cols, 1);
+    for(int f=0; f<samples.cols; f++){
+        double min_value, max_value;
+        minMaxLoc(samples.col(f), &min_value, &max_value);
+        // Keep the features that are positive without offset
+        this->offset[f]= (float)(min_value<0?min_value:0);
+        double range= max_value-this->offset[f];
+        this->scale[f]= (float)(range>0?1.0/range:1.0);
+    }
+}
+
+int Chi2FeatureMap::mappedSize() const
+{
+    return (int)this->scale.size()*(2*this->order+1);
+}
+
+void Chi2FeatureMap::transform(Mat samples, Mat &mapped) const
+{
+    CV_Assert(samples.type()==CV_32FC1 && samples.cols==(int)this->scale.size());
+    int values= 2*this->order+1;
+    mapped.create(samples.rows, this->mappedSize(), CV_32FC1);
+    for(int i=0; i<samples.rows; i++){
+        const float *sample= samples.ptr<float>(i);
+        float *out= mapped.ptr<float>(i);
+        for(int f=0; f<samples.cols; f++, out+= values){
+            float x= (sample[f]-this->offset[f])*this->scale[f];
+            if(x<=0){
+                for(int v=0; v<values; v++)
+                    out[v]= 0;
+                continue;
+            }
+            float sqrt_x= sqrt(x);
+            float log_x= log(x);
+            out[0]= this->spectrum[0]*sqrt_x;
+            for(int j=1; j<=this->order; j++){
+                float a= this->spectrum[j]*sqrt_x;
+                float omega= (float)(j*this->period)*log_x;
+                out[2*j-1]= a*cos(omega);
+                out[2*j]= a*sin(omega);
+            }
+        }
+    }
+}
+
+void Chi2FeatureMap::write(FileStorage &fs) const
+{
+    fs << "order" << this->order;
+    fs << "period" << this->period;
+    fs << "offset" << this->offset;
+    fs << "scale" << this->scale;
+}
+
+void Chi2FeatureMap::read(const FileNode &node)
+{
+    node["order"] >> this->order;
+    node["period"] >> this->period;
+    node["offset"] >> this->offset;
+    node["scale"] >> this->scale;
+    this->computeSpectrum();
+}
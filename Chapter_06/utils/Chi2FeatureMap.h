@@ -0,0 +1,71 @@
+/**
+ * Chi2 Feature Map
+ *
+ * Explicit approximation of the additive chi-squared kernel, the homogeneous
+ * kernel map of Vedaldi and Zisserman. Each feature x is mapped to 2*order+1
+ * values sampling the spectrum of the kernel with a period, so the dot
+ * product of two mapped samples approximates the chi-squared kernel between
+ * them and a linear model over the mapped samples predicts with one small
+ * dot product by decision function.
+ *
+ * The kernel is defined for non negative values, each feature is scaled
+ * with the range seen when fitting the map.
+ *
+ */
+
+#ifndef CHI2_FEATURE_MAP_h
+#define CHI2_FEATURE_MAP_h
+
+#include <vector>
+using namespace std;
+
+// OpenCV includes
+#include "opencv2/core.hpp"
+using namespace cv;
+
+class Chi2FeatureMap
+{
+    public:
+        /**
+         * Constructor
+         *
+         * @param int order number of frequencies sampled, each feature is mapped to 2*order+1 values
+         * @param double period sampling period of the kernel spectrum
+         */
+        Chi2FeatureMap(int order= 2, double period= 0.5);
+
+        /**
+         * Learn the range of each feature
+         * @param Mat samples CV_32FC1 matrix with a row by sample
+         */
+        void fit(Mat samples);
+
+        /**
+         * Map the samples
+         * @param Mat samples CV_32FC1 matrix with a row by sample
+         * @param Mat mapped output CV_32FC1 matrix with mappedSize() columns
+         */
+        void transform(Mat samples, Mat &mapped) const;
+
+        /**
+         * Number of values of a mapped sample
+         */
+        int mappedSize() const;
+
+        void write(FileStorage &fs) const;
+
+        void read(const FileNode &node);
+
+    private:
+        int order;
+        double period;
+        // Scale of each frequency of the spectrum
+        vector<float> spectrum;
+        vector<float> offset;
+        vector<float> scale;
+
+        void computeSpectrum();
+};
+
+
+#endif
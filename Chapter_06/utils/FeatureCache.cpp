@@ -0,0 +1,243 @@
+#include "FeatureCache.h"
+
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+const char cache_magic[8] = {'C', 'H', '6', 'F', 'E', 'A', 'T', '\0'};
+const uint32_t cache_version = 1;
+
+struct CacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t num_features;
+    uint64_t params_hash;
+    uint64_t num_entries;
+    uint64_t num_rows;
+    uint64_t paths_size;
+};
+
+struct CacheEntry
+{
+    int64_t size;
+    int64_t mtime;
+    uint64_t first_row;
+    uint32_t num_rows;
+    uint32_t path_length;
+    uint64_t path_offset;
+};
+
+}
+
+FeatureCache::FeatureCache(string file, uint64_t params_hash, int num_features)
+{
+    this->file= file;
+    this->params_hash= params_hash;
+    this->num_features= num_features;
+    this->data= NULL;
+    this->data_size= 0;
+}
+
+FeatureCache::~FeatureCache()
+{
+    this->unmap();
+}
+
+void FeatureCache::unmap()
+{
+#ifndef _WIN32
+    if(this->data!=NULL && this->buffer.empty())
+        munmap((void*)this->data, this->data_size);
+#endif
+    this->buffer.clear();
+    this->data= NULL;
+    this->data_size= 0;
+    this->entries.clear();
+}
+
+bool FeatureCache::load()
+{
+    this->unmap();
+#ifndef _WIN32
+    int fd= open(this->file.c_str(), O_RDONLY);
+    if(fd<0)
+        return false;
+    struct stat st;
+    if(fstat(fd, &st)!=0 || st.st_size<(off_t)sizeof(CacheHeader)){
+        close(fd);
+        return false;
+    }
+    void *mapped= mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapped==MAP_FAILED)
+        return false;
+    this->data= (const char*)mapped;
+    this->data_size= st.st_size;
+#else
+    ifstream in(this->file.c_str(), ios::binary | ios::ate);
+    if(!in.good())
+        return false;
+    this->buffer.resize((size_t)in.tellg());
+    in.seekg(0);
+    in.read(this->buffer.data(), this->buffer.size());
+    if(!in.good() || this->buffer.size()<sizeof(CacheHeader)){
+        this->buffer.clear();
+        return false;
+    }
+    this->data= this->buffer.data();
+    this->data_size= this->buffer.size();
+#endif
+
+    // Check the file was created with the same parameters and is complete
+    const CacheHeader *header= (const CacheHeader*)this->data;
+    size_t rows_offset= sizeof(CacheHeader)+header->num_entries*sizeof(CacheEntry);
+    size_t paths_offset= rows_offset+header->num_rows*this->num_features*sizeof(float);
+    if(memcmp(header->magic, cache_magic, sizeof(cache_magic))!=0 ||
+       header->version!=cache_version ||
+       header->num_features!=(uint32_t)this->num_features ||
+       header->params_hash!=this->params_hash ||
+       paths_offset+header->paths_size!=this->data_size){
+        this->unmap();
+        return false;
+    }
+
+    const CacheEntry *table= (const CacheEntry*)(this->data+sizeof(CacheHeader));
+    const char *paths= this->data+paths_offset;
+    for(size_t i=0; i<header->num_entries; i++){
+        const CacheEntry &entry= table[i];
+        if(entry.path_offset+entry.path_length>header->paths_size ||
+           entry.first_row+entry.num_rows>header->num_rows){
+            this->unmap();
+            return false;
+        }
+        this->entries[string(paths+entry.path_offset, entry.path_length)]= i;
+    }
+    return true;
+}
+
+bool FeatureCache::lookup(const string &path, vector<float> &rows) const
+{
+    unordered_map<string, size_t>::const_iterator it= this->entries.find(path);
+    if(it==this->entries.end())
+        return false;
+    const CacheHeader *header= (const CacheHeader*)this->data;
+    const CacheEntry &entry= ((const CacheEntry*)(this->data+sizeof(CacheHeader)))[it->second];
+    int64_t size, mtime;
+    if(!fileStat(path, size, mtime) || size!=entry.size || mtime!=entry.mtime)
+        return false;
+    const float *all_rows= (const float*)(this->data+sizeof(CacheHeader)+header->num_entries*sizeof(CacheEntry));
+    const float *first= all_rows+entry.first_row*this->num_features;
+    rows.assign(first, first+entry.num_rows*this->num_features);
+    return true;
+}
+
+void FeatureCache::store(const string &path, const float *rows, int num_rows)
+{
+    Update &update= this->updates[path];
+    if(!fileStat(path, update.size, update.mtime)){
+        this->updates.erase(path);
+        return;
+    }
+    update.rows.assign(rows, rows+num_rows*this->num_features);
+}
+
+bool FeatureCache::save()
+{
+    if(this->updates.empty())
+        return true;
+
+    // Keep the mapped entries that were not replaced, then the new ones
+    vector<CacheEntry> table;
+    vector<float> rows;
+    string paths;
+    if(this->data!=NULL){
+        const CacheHeader *header= (const CacheHeader*)this->data;
+        const CacheEntry *old_table= (const CacheEntry*)(this->data+sizeof(CacheHeader));
+        const float *old_rows= (const float*)(old_table+header->num_entries);
+        for(unordered_map<string, size_t>::iterator it= this->entries.begin(); it!=this->entries.end(); ++it){
+            if(this->updates.count(it->first))
+                continue;
+            CacheEntry entry= old_table[it->second];
+            const float *first= old_rows+entry.first_row*this->num_features;
+            entry.first_row= rows.size()/this->num_features;
+            entry.path_offset= paths.size();
+            rows.insert(rows.end(), first, first+entry.num_rows*this->num_features);
+            paths+= it->first;
+            table.push_back(entry);
+        }
+    }
+    for(map<string, Update>::iterator it= this->updates.begin(); it!=this->updates.end(); ++it){
+        CacheEntry entry;
+        entry.size= it->second.size;
+        entry.mtime= it->second.mtime;
+        entry.first_row= rows.size()/this->num_features;
+        entry.num_rows= it->second.rows.size()/this->num_features;
+        entry.path_length= it->first.size();
+        entry.path_offset= paths.size();
+        rows.insert(rows.end(), it->second.rows.begin(), it->second.rows.end());
+        paths+= it->first;
+        table.push_back(entry);
+    }
+
+    CacheHeader header;
+    memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version= cache_version;
+    header.num_features= this->num_features;
+    header.params_hash= this->params_hash;
+    header.num_entries= table.size();
+    header.num_rows= rows.size()/this->num_features;
+    header.paths_size= paths.size();
+
+    // Write a temporary file and replace the old one, the mapped file stays valid
+    string tmp_file= this->file+".tmp";
+    {
+        ofstream out(tmp_file.c_str(), ios::binary | ios::trunc);
+        out.write((const char*)&header, sizeof(header));
+        if(!table.empty())
+            out.write((const char*)table.data(), table.size()*sizeof(CacheEntry));
+        if(!rows.empty())
+            out.write((const char*)rows.data(), rows.size()*sizeof(float));
+        out.write(paths.data(), paths.size());
+        if(!out.good())
+            return false;
+    }
+    this->unmap();
+#ifdef _WIN32
+    remove(this->file.c_str());
+#endif
+    if(rename(tmp_file.c_str(), this->file.c_str())!=0)
+        return false;
+    this->updates.clear();
+    return this->load();
+}
+
+bool FeatureCache::fileStat(const string &path, int64_t &size, int64_t &mtime)
+{
+    struct stat st;
+    if(stat(path.c_str(), &st)!=0)
+        return false;
+    size= (int64_t)st.st_size;
+    mtime= (int64_t)st.st_mtime;
+    return true;
+}
+
+uint64_t FeatureCache::hash(const void *data, size_t size, uint64_t seed)
+{
+    const unsigned char *bytes= (const unsigned char*)data;
+    uint64_t h= seed;
+    for(size_t i=0; i<size; i++){
+        h^= bytes[i];
+        h*= 1099511628211ULL;
+    }
+    return h;
+}
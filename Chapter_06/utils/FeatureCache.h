@@ -0,0 +1,108 @@
+/**
+ * Feature Cache
+ *
+ * Persist the features extracted from each training image in a compact
+ * binary file, so the dataset is only decoded and segmented again for the
+ * images that changed.
+ *
+ * Each entry is keyed by the image path, its size and its modification
+ * time. The whole file is tagged with a hash of the preprocessing
+ * parameters and the number of features by row, if any of them changes
+ * every entry is stale.
+ *
+ * File layout, all fields little endian and 8 bytes aligned so the file
+ * can be memory mapped and used in place:
+ *
+ *   header | entries[num_entries] | rows[num_rows][num_features] | paths
+ *
+ */
+
+#ifndef FEATURE_CACHE_h
+#define FEATURE_CACHE_h
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+using namespace std;
+
+class FeatureCache
+{
+    public:
+        /**
+         * Constructor
+         *
+         * @param string file path of the cache file
+         * @param uint64_t params_hash hash of the parameters used to extract the features
+         * @param int num_features number of features by row
+         */
+        FeatureCache(string file, uint64_t params_hash, int num_features);
+
+        ~FeatureCache();
+
+        /**
+         * Map the cache file, the cache is empty if the file does not exist
+         * or was created with other parameters
+         * @return bool true if the file was loaded
+         */
+        bool load();
+
+        /**
+         * Look for the features of an image, checking that the image file
+         * has not changed since they were stored
+         * @param string path image file
+         * @param vector<float> rows output of the rows of features, one after another
+         * @return bool true if the features are in the cache and up to date
+         */
+        bool lookup(const string &path, vector<float> &rows) const;
+
+        /**
+         * Add or replace the features of an image, they are written in the next save
+         * @param string path image file
+         * @param float* rows rows of features, one after another
+         * @param int num_rows number of rows
+         */
+        void store(const string &path, const float *rows, int num_rows);
+
+        /**
+         * Write the cache file if any entry was stored
+         * @return bool false in error case
+         */
+        bool save();
+
+        /**
+         * FNV-1a hash of a block of memory, chain calls with the seed
+         */
+        static uint64_t hash(const void *data, size_t size, uint64_t seed = 14695981039346656037ULL);
+
+        /**
+         * Size and modification time of a file, the key of its entry
+         * @return bool false if the file does not exist
+         */
+        static bool fileStat(const string &path, int64_t &size, int64_t &mtime);
+
+    private:
+        struct Update
+        {
+            int64_t size;
+            int64_t mtime;
+            vector<float> rows;
+        };
+
+        void unmap();
+
+        string file;
+        uint64_t params_hash;
+        int num_features;
+        // Mapped file, or buffer where it was read when mmap is not available
+        const char *data;
+        size_t data_size;
+        vector<char> buffer;
+        // Index of each path in the mapped entries
+        unordered_map<string, size_t> entries;
+        map<string, Update> updates;
+};
+
+
+#endif
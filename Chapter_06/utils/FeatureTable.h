@@ -0,0 +1,104 @@
+/**
+ * Feature Table
+ *
+ * Table of features with a row for each object and a fixed number of
+ * features known at compile time. All the rows are stored one after
+ * another in a single buffer that keeps its capacity when the table is
+ * cleared, so adding objects does not allocate memory for each one and the
+ * table can be used by cv::ml as a CV_32FC1 Mat without copying it.
+ *
+ */
+
+#ifndef FEATURE_TABLE_h
+#define FEATURE_TABLE_h
+
+#include <vector>
+using namespace std;
+
+// OpenCV includes
+#include "opencv2/core.hpp"
+using namespace cv;
+
+template<int F>
+class FeatureTable
+{
+    public:
+        enum { num_features = F };
+
+        FeatureTable(): num_rows(0) {}
+
+        /**
+         * Reserve memory for num_rows rows
+         */
+        void reserve(int num_rows)
+        {
+            this->data.reserve(num_rows*F);
+        }
+
+        /**
+         * Add a new row at the end of the table
+         * @return float* pointer to the F features of the new row
+         */
+        float* addRow()
+        {
+            this->data.resize(this->data.size()+F);
+            this->num_rows++;
+            return &this->data[this->data.size()-F];
+        }
+
+        /**
+         * Add num_rows rows at the end of the table
+         * @param float* rows features of the rows, one row after another
+         * @param int num_rows number of rows
+         */
+        void addRows(const float *rows, int num_rows)
+        {
+            this->data.insert(this->data.end(), rows, rows+num_rows*F);
+            this->num_rows+= num_rows;
+        }
+
+        /**
+         * Add all the rows of other table at the end of this table
+         */
+        void append(const FeatureTable<F> &other)
+        {
+            if(other.num_rows>0)
+                this->addRows(other.row(0), other.num_rows);
+        }
+
+        /**
+         * Remove all rows keeping the allocated memory
+         */
+        void clear()
+        {
+            this->data.clear();
+            this->num_rows= 0;
+        }
+
+        int size() const { return this->num_rows; }
+
+        bool empty() const { return this->num_rows==0; }
+
+        float* row(int i) { return &this->data[i*F]; }
+
+        const float* row(int i) const { return &this->data[i*F]; }
+
+        /**
+         * Header of a Mat with a row by object that uses the table memory,
+         * valid until new rows are added to the table
+         * @return Mat num_rows x F CV_32FC1 matrix
+         */
+        Mat mat()
+        {
+            if(this->num_rows==0)
+                return Mat();
+            return Mat(this->num_rows, F, CV_32FC1, this->data.data());
+        }
+
+    private:
+        int num_rows;
+        vector<float> data;
+};
+
+
+#endif
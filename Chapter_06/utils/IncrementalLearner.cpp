@@ -0,0 +1,187 @@
+#include "IncrementalLearner.h"
+
+#include <cstdio>
+#include <numeric>
+#include <algorithm>
+
+#include "PartsDataset.h"
+
+IncrementalLearner::IncrementalLearner(double lambda, double learning_rate)
+{
+    this->lambda= lambda;
+    this->learning_rate= learning_rate;
+    this->num_steps= 0;
+    this->num_classes= 0;
+    this->training_hash= 0;
+    this->snapshot_every= 0;
+    this->updates_since_snapshot= 0;
+}
+
+void IncrementalLearner::init(Mat samples, Mat responses, uint64_t training_hash, int epochs)
+{
+    this->training_hash= training_hash;
+    this->chi2_map.fit(samples);
+    Mat mapped;
+    this->chi2_map.transform(samples, mapped);
+    double max_label;
+    minMaxLoc(responses, NULL, &max_label);
+    this->num_classes= (int)max_label+1;
+    this->weights= Mat::zeros(this->num_classes, mapped.cols+1, CV_32FC1);
+    this->num_steps= 0;
+
+    // The same order every run, so the initial model does not change
+    vector<int> order(samples.rows);
+    iota(order.begin(), order.end(), 0);
+    RNG rng(0xFFFFFFFF);
+    for(int e=0; e<epochs; e++){
+        for(int i=(int)order.size()-1; i>0; i--)
+            swap(order[i], order[rng.uniform(0, i+1)]);
+        for(size_t i=0; i<order.size(); i++)
+            this->step(mapped.ptr<float>(order[i]), responses.at<int>(order[i]));
+    }
+}
+
+void IncrementalLearner::addSample(const float *features, int label)
+{
+    Mat mapped;
+    this->chi2_map.transform(Mat(1, num_features, CV_32FC1, (void*)features), mapped);
+    this->pending.push_back(mapped);
+    this->pending_labels.push_back(label);
+}
+
+int IncrementalLearner::updateModel()
+{
+    int learned= (int)this->pending_labels.size();
+    for(int i=0; i<learned; i++)
+        this->step(this->pending.ptr<float>(i), this->pending_labels[i]);
+    this->pending.resize(0);
+    this->pending_labels.clear();
+
+    if(learned>0 && !this->snapshot_file.empty() && ++this->updates_since_snapshot>=this->snapshot_every){
+        if(this->save(this->snapshot_file))
+            this->updates_since_snapshot= 0;
+    }
+    return learned;
+}
+
+void IncrementalLearner::step(const float *mapped, int label)
+{
+    // A new label adds an SVM for its class
+    if(label>=this->num_classes){
+        Mat grown= Mat::zeros(label+1, this->weights.cols, CV_32FC1);
+        if(this->num_classes>0)
+            this->weights.copyTo(grown.rowRange(0, this->num_classes));
+        this->weights= grown;
+        this->num_classes= label+1;
+    }
+    // Hinge loss gradient step of each class against the rest, with a
+    // learning rate that decays with the number of steps
+    int dims= this->weights.cols-1;
+    float rate= (float)(this->learning_rate/(1.0+this->learning_rate*this->lambda*this->num_steps));
+    float shrink= 1.0f-rate*(float)this->lambda;
+    for(int c=0; c<this->num_classes; c++){
+        float *w= this->weights.ptr<float>(c);
+        float target= c==label?1.0f:-1.0f;
+        float score= w[dims];
+        for(int d=0; d<dims; d++)
+            score+= w[d]*mapped[d];
+        for(int d=0; d<dims; d++)
+            w[d]*= shrink;
+        if(target*score<1){
+            for(int d=0; d<dims; d++)
+                w[d]+= rate*target*mapped[d];
+            w[dims]+= rate*target;
+        }
+    }
+    this->num_steps++;
+}
+
+void IncrementalLearner::predict(Mat samples, Mat &results) const
+{
+    Mat mapped;
+    this->chi2_map.transform(samples, mapped);
+    results.create(samples.rows, 1, CV_32FC1);
+    int dims= this->weights.cols-1;
+    for(int i=0; i<samples.rows; i++){
+        const float *x= mapped.ptr<float>(i);
+        int best= 0;
+        float best_score= 0;
+        for(int c=0; c<this->num_classes; c++){
+            const float *w= this->weights.ptr<float>(c);
+            float score= w[dims];
+            for(int d=0; d<dims; d++)
+                score+= w[d]*x[d];
+            if(c==0 || score>best_score){
+                best= c;
+                best_score= score;
+            }
+        }
+        results.at<float>(i)= (float)best;
+    }
+}
+
+void IncrementalLearner::setSnapshot(string file, int snapshot_every)
+{
+    this->snapshot_file= file;
+    this->snapshot_every= max(1, snapshot_every);
+    this->updates_since_snapshot= 0;
+}
+
+bool IncrementalLearner::load(string file, uint64_t training_hash)
+{
+    FileStorage fs;
+    if(!fs.open(file, FileStorage::READ))
+        return false;
+    // Check the snapshot was saved with the same features and training set
+    FileNode names= fs["features"];
+    bool valid= (int)fs["num_features"]==num_features && (int)names.size()==num_features;
+    for(int i=0; valid && i<num_features; i++)
+        valid= (String)names[i]==PartDescriptors::featureName(i);
+    if(!valid || (String)fs["training_hash"]!=format("%016llx", (unsigned long long)training_hash))
+        return false;
+    Mat weights;
+    fs["weights"] >> weights;
+    if(weights.empty())
+        return false;
+    this->chi2_map.read(fs["chi2_map"]);
+    if(weights.cols!=this->chi2_map.mappedSize()+1)
+        return false;
+    fs["lambda"] >> this->lambda;
+    fs["learning_rate"] >> this->learning_rate;
+    this->num_steps= (uint64_t)(double)fs["steps"];
+    this->weights= weights;
+    this->num_classes= weights.rows;
+    this->training_hash= training_hash;
+    return true;
+}
+
+bool IncrementalLearner::save(string file) const
+{
+    // The temporary file keeps the extension, FileStorage chooses the format with it
+    size_t dot= file.find_last_of('.');
+    size_t slash= file.find_last_of("/\\");
+    bool has_extension= dot!=string::npos && (slash==string::npos || dot>slash);
+    string tmp_file= has_extension?file.substr(0, dot)+".tmp"+file.substr(dot):file+".tmp";
+    {
+        FileStorage fs;
+        if(!fs.open(tmp_file, FileStorage::WRITE))
+            return false;
+        fs << "num_features" << num_features;
+        fs << "features" << "[";
+        for(int i=0; i<num_features; i++)
+            fs << PartDescriptors::featureName(i);
+        fs << "]";
+        fs << "training_hash" << format("%016llx", (unsigned long long)this->training_hash);
+        fs << "lambda" << this->lambda;
+        fs << "learning_rate" << this->learning_rate;
+        fs << "steps" << (double)this->num_steps;
+        fs << "chi2_map" << "{";
+        this->chi2_map.write(fs);
+        fs << "}";
+        fs << "weights" << this->weights;
+    }
+#ifdef _WIN32
+    remove(file.c_str());
+#endif
+    return rename(tmp_file.c_str(), file.c_str())==0;
+}
@@ -0,0 +1,118 @@
+/**
+ * Incremental Learner
+ *
+ * Parts classifier that learns new labeled samples without training again
+ * with the whole dataset: a linear SVM for each class against the rest over
+ * the chi-squared feature map, trained with stochastic gradient descent.
+ * Each new sample is one gradient step, its cost only depends on the number
+ * of classes and features, not on the number of samples seen.
+ *
+ * The samples added are learned in the next updateModel call. The model is
+ * saved in a snapshot file every snapshot_every updates, the file is written
+ * to a temporary file and renamed so a crash never leaves a partial model.
+ *
+ */
+
+#ifndef INCREMENTAL_LEARNER_h
+#define INCREMENTAL_LEARNER_h
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+// OpenCV includes
+#include "opencv2/core.hpp"
+using namespace cv;
+
+#include "Chi2FeatureMap.h"
+
+class IncrementalLearner
+{
+    public:
+        /**
+         * Constructor
+         *
+         * @param double lambda regularization of the SVMs
+         * @param double learning_rate initial learning rate, it decays with the number of steps
+         */
+        IncrementalLearner(double lambda= 1e-4, double learning_rate= 0.1);
+
+        /**
+         * Learn the feature map and train the model with an initial dataset
+         * @param Mat samples CV_32FC1 matrix with a row of features by part
+         * @param Mat responses CV_32SC1 label of each part
+         * @param uint64_t training_hash hash of the training set, saved in the snapshots
+         * @param int epochs passes over the samples, in a fixed random order
+         */
+        void init(Mat samples, Mat responses, uint64_t training_hash, int epochs= 10);
+
+        /**
+         * Add a labeled sample, it is learned in the next updateModel call
+         * @param float* features features of the part
+         * @param int label label of the part, new labels add a class
+         */
+        void addSample(const float *features, int label);
+
+        /**
+         * Learn the samples added since the previous update, one gradient step
+         * by sample, and save a snapshot if required
+         * @return int number of samples learned
+         */
+        int updateModel();
+
+        /**
+         * Classify the parts
+         * @param Mat samples CV_32FC1 matrix with a row of features by part
+         * @param Mat results output CV_32FC1 with the label of each part
+         */
+        void predict(Mat samples, Mat &results) const;
+
+        /**
+         * Save a snapshot of the model every snapshot_every updates
+         * @param string file snapshot file, empty disables the snapshots
+         * @param int snapshot_every number of updates between snapshots
+         */
+        void setSnapshot(string file, int snapshot_every);
+
+        /**
+         * Load a snapshot if it was saved with the same features and training set
+         * @param uint64_t training_hash hash of the current training set
+         * @return bool true if the snapshot was loaded
+         */
+        bool load(string file, uint64_t training_hash);
+
+        /**
+         * Save the model and the hash of its training set in a file, writing
+         * a temporary file and renaming it
+         * @return bool true if the model was saved
+         */
+        bool save(string file) const;
+
+        bool isTrained() const { return this->num_classes>0; }
+
+        // Number of gradient steps done
+        uint64_t steps() const { return this->num_steps; }
+
+    private:
+        void step(const float *mapped, int label);
+
+        double lambda;
+        double learning_rate;
+        uint64_t num_steps;
+        int num_classes;
+        // Hash of the training set and preprocessing of the initial model
+        uint64_t training_hash;
+        Chi2FeatureMap chi2_map;
+        // A row by class with the weights of the mapped features and the bias at the end
+        Mat weights;
+        // Mapped samples and labels waiting for the next update
+        Mat pending;
+        vector<int> pending_labels;
+        string snapshot_file;
+        int snapshot_every;
+        int updates_since_snapshot;
+};
+
+
+#endif
@@ -0,0 +1,103 @@
+#include "PartsClassifier.h"
+
+#include <iostream>
+
+#include "PartsDataset.h"
+
+PartsClassifier::PartsClassifier(bool use_feature_map)
+{
+    this->use_feature_map= use_feature_map;
+}
+
+Ptr<SVM> PartsClassifier::createSVM() const
+{
+    Ptr<SVM> svm= SVM::create();
+    svm->setType(SVM::C_SVC);
+    svm->setNu(0.05);
+    svm->setKernel(this->use_feature_map?SVM::LINEAR:SVM::CHI2);
+    svm->setDegree(1.0);
+    svm->setGamma(2.0);
+    svm->setTermCriteria(TermCriteria(TermCriteria::MAX_ITER, 100, 1e-6));
+    return svm;
+}
+
+void PartsClassifier::train(Ptr<SVM> svm, Mat samples, Mat responses)
+{
+    Ptr<TrainData> tdata;
+    if(this->use_feature_map){
+        // The linear SVM uses the mapped features, the prediction is a dot product
+        this->chi2_map.fit(samples);
+        Mat mapped;
+        this->chi2_map.transform(samples, mapped);
+        tdata= TrainData::create(mapped, ROW_SAMPLE, responses);
+    }else{
+        tdata= TrainData::create(samples, ROW_SAMPLE, responses);
+    }
+    svm->train(tdata);
+    this->svm= svm;
+}
+
+void PartsClassifier::predict(Mat samples, Mat &results) const
+{
+    if(this->use_feature_map){
+        Mat mapped;
+        this->chi2_map.transform(samples, mapped);
+        this->svm->predict(mapped, results);
+    }else{
+        this->svm->predict(samples, results);
+    }
+}
+
+bool PartsClassifier::isTrained() const
+{
+    return !this->svm.empty() && this->svm->isTrained();
+}
+
+bool PartsClassifier::load(string file, uint64_t training_hash)
+{
+    FileStorage fs;
+    if(!fs.open(file, FileStorage::READ)){
+        cout << "Can not open the model " << file << ", training it" << endl;
+        return false;
+    }
+    // Check the model was trained with the same features and training set
+    FileNode names= fs["features"];
+    bool valid= (int)fs["num_features"]==num_features && (int)names.size()==num_features &&
+                (int)fs["feature_map"]==(int)this->use_feature_map;
+    for(int i=0; valid && i<num_features; i++)
+        valid= (String)names[i]==PartDescriptors::featureName(i);
+    if(!valid || (String)fs["training_hash"]!=format("%016llx", (unsigned long long)training_hash)){
+        cout << "The model " << file << " does not match the training set, training it" << endl;
+        return false;
+    }
+    Ptr<SVM> model= Algorithm::read<SVM>(fs["svm"]);
+    if(model.empty() || !model->isTrained())
+        return false;
+    this->svm= model;
+    if(this->use_feature_map)
+        this->chi2_map.read(fs["chi2_map"]);
+    return true;
+}
+
+bool PartsClassifier::save(string file, uint64_t training_hash) const
+{
+    FileStorage fs;
+    if(!fs.open(file, FileStorage::WRITE))
+        return false;
+    fs << "num_features" << num_features;
+    fs << "features" << "[";
+    for(int i=0; i<num_features; i++)
+        fs << PartDescriptors::featureName(i);
+    fs << "]";
+    fs << "training_hash" << format("%016llx", (unsigned long long)training_hash);
+    fs << "feature_map" << (int)this->use_feature_map;
+    if(this->use_feature_map){
+        fs << "chi2_map" << "{";
+        this->chi2_map.write(fs);
+        fs << "}";
+    }
+    fs << "svm" << "{";
+    this->svm->write(fs);
+    fs << "}";
+    return true;
+}
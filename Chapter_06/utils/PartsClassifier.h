@@ -0,0 +1,85 @@
+/**
+ * Parts Classifier
+ *
+ * SVM that classifies the parts, optionally a linear SVM over the explicit
+ * chi-squared feature map, with the model file shared by the Chapter 6
+ * applications. The model file stores the SVM, the feature map, the name of
+ * each feature and the hash of the training set, a model is only loaded if
+ * it matches the current features and training set.
+ *
+ */
+
+#ifndef PARTS_CLASSIFIER_h
+#define PARTS_CLASSIFIER_h
+
+#include <stdint.h>
+#include <string>
+using namespace std;
+
+// OpenCV includes
+#include "opencv2/core.hpp"
+#include "opencv2/ml.hpp"
+using namespace cv;
+using namespace cv::ml;
+
+#include "Chi2FeatureMap.h"
+
+class PartsClassifier
+{
+    public:
+        /**
+         * Constructor
+         *
+         * @param bool use_feature_map use a linear SVM over the chi-squared feature map
+         */
+        PartsClassifier(bool use_feature_map= false);
+
+        /**
+         * SVM with the parameters of the Chapter 6 application, a LINEAR
+         * kernel if the feature map is used, else the CHI2 kernel
+         */
+        Ptr<SVM> createSVM() const;
+
+        /**
+         * Train the classifier
+         * @param Ptr<SVM> svm configured SVM to train
+         * @param Mat samples CV_32FC1 matrix with a row of features by part
+         * @param Mat responses CV_32SC1 label of each part
+         */
+        void train(Ptr<SVM> svm, Mat samples, Mat responses);
+
+        /**
+         * Classify the parts, mapping their features first if the linear SVM is used
+         * @param Mat samples CV_32FC1 matrix with a row of features by part
+         * @param Mat results output with the label of each part
+         */
+        void predict(Mat samples, Mat &results) const;
+
+        /**
+         * Load the model if it was trained with the same features and training set
+         * @param string file model file
+         * @param uint64_t training_hash hash of the current training set
+         * @return bool true if the model was loaded, false if it must be trained again
+         */
+        bool load(string file, uint64_t training_hash);
+
+        /**
+         * Save the model with its features and the hash of its training set
+         * @param string file model file
+         * @param uint64_t training_hash hash of the training set
+         * @return bool true if the model was saved
+         */
+        bool save(string file, uint64_t training_hash) const;
+
+        bool isTrained() const;
+
+        Ptr<SVM> getSVM() const { return this->svm; }
+
+    private:
+        bool use_feature_map;
+        Chi2FeatureMap chi2_map;
+        Ptr<SVM> svm;
+};
+
+
+#endif
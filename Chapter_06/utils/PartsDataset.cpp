@@ -0,0 +1,348 @@
+#include "PartsDataset.h"
+
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <algorithm>
+
+// OpenCV includes
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/highgui.hpp>
+
+/**
+* Extract the features for all objects in one image
+*
+* @param Mat img input image
+* @param vector<int> left output of left coordinates for each object
+* @param vector<int> top output of top coordintates for each object
+* @param MultipleImageWindow miw window where display each detected object, only from the main thread
+* @return PartFeatures a table with a row of features for each object detected
+**/
+PartFeatures ExtractFeatures(Mat img, vector<int> *left, vector<int> *top, MultipleImageWindow *miw) {
+    // 输出变量
+    // 查找轮廓算法分割中使用的轮廓变量
+    // 输入图像的副本，findcoutours 函数会修改输入图像
+    PartFeatures output;
+    vector<vector<Point> > contours;
+    Mat input = img.clone();
+
+    vector<Vec4i> hierarchy;
+    findContours(input, contours, hierarchy, RETR_CCOMP, CHAIN_APPROX_SIMPLE);
+    // Check the number of objects detected
+    if (contours.empty()) {
+        return output;
+    }
+    float row[num_features];
+    for (int i = 0; i < contours.size(); i++) {
+        // 孔洞属于包含它们的对象，只处理外轮廓
+        if (hierarchy[i][3] >= 0)
+            continue;
+        // 一次遍历轮廓及其孔洞计算所有描述符，面积小于最小值的对象被丢弃
+        Point2f center;
+        if (!PartDescriptors::compute(contours, hierarchy, i, min_object_area, row, &center))
+            continue;
+        // 添加到特征表
+        output.addRows(row, 1);
+        // 如果传递了其它参数，则添加中心的值以输出这些参数
+        if (left != NULL) {
+            left->push_back((int) center.x);
+        }
+        if (top != NULL) {
+            top->push_back((int) center.y);
+        }
+        // 显示检测到的对象
+        if (miw != NULL) {
+            Mat mask = Mat::zeros(img.rows, img.cols, CV_8UC1);
+            drawContours(mask, contours, i, Scalar(255), FILLED, LINE_8, hierarchy, 1);
+            miw->addImage("Extract Features", mask);
+            miw->render();
+            waitKey(10);
+        }
+    }
+    return output;
+}
+
+/**
+ * Workspace of the calling thread
+ * @return PreprocessWorkspace buffers owned by the thread
+ */
+PreprocessWorkspace &threadWorkspace() {
+    static thread_local PreprocessWorkspace ws;
+    return ws;
+}
+
+/**
+ * Remove th light and return new image without light
+ * @param img Mat image to remove the light pattern
+ * @param pattern Mat image with light pattern
+ * @return a new image Mat without light
+ */
+Mat removeLight(Mat img, Mat pattern) {
+    PreprocessWorkspace ws;
+    return removeLight(img, pattern, ws);
+}
+
+/**
+ * Remove the light using the buffers of a workspace
+ * @param img Mat image to remove the light pattern
+ * @param pattern Mat image with light pattern
+ * @param ws PreprocessWorkspace buffers reused between calls
+ * @return Mat image without light, stored in the workspace
+ */
+Mat removeLight(Mat img, Mat pattern, PreprocessWorkspace &ws) {
+    // Require change our image to 32 float for division, the pattern is
+    // converted only the first time it is used
+    img.convertTo(ws.img32, CV_32F);
+    if (ws.pattern.data != pattern.data || ws.pattern.size() != pattern.size()) {
+        pattern.convertTo(ws.pattern32, CV_32F);
+        ws.pattern = pattern;
+    }
+    // Divide the image by the pattern, 1 - (img32 / pattern32) in place
+    divide(ws.img32, ws.pattern32, ws.ratio);
+    subtract(Scalar::all(1), ws.ratio, ws.ratio);
+    // Scale it to convert o 8bit format
+    ws.ratio.convertTo(ws.no_light, CV_8U, 255);
+
+    //equalizeHist( aux, aux );
+    return ws.no_light;
+}
+
+/**
+* Preprocess an input image to extract components and stats
+* @params Mat input image to preprocess
+* @params Mat pattern light pattern
+* @return Mat binary image
+*/
+Mat preprocessImage(Mat input, Mat pattern) {
+    PreprocessWorkspace ws;
+    return preprocessImage(input, pattern, ws);
+}
+
+/**
+* Preprocess an input image using the buffers of a workspace
+* @params Mat input image to preprocess
+* @params Mat pattern light pattern
+* @params ws PreprocessWorkspace buffers reused between calls
+* @return Mat binary image, stored in the workspace
+*/
+Mat preprocessImage(Mat input, Mat pattern, PreprocessWorkspace &ws) {
+    if (input.channels() == 3) {
+        cvtColor(input, ws.gray, COLOR_RGB2GRAY);
+        input = ws.gray;
+    }
+    // Remove noise
+    medianBlur(input, ws.noise, 3);
+
+    //Apply the light pattern
+    Mat img_no_light = removeLight(ws.noise, pattern, ws);
+
+    // Binarize image for segment
+    threshold(img_no_light, ws.binary, binary_threshold, 255, THRESH_BINARY);
+
+    return ws.binary;
+}
+
+/**
+* List the images of a folder sequence in the same order VideoCapture reads them
+* @param folder string printf like pattern of the sequence, ex: tuerca_%04d.pgm
+* @param files vector where store the path of each image of the sequence
+* @return true if the sequence has images, false in error case
+**/
+bool listFolderImages(string folder, vector<string> &files) {
+    // VideoCapture starts the sequence at the first existing index between 0 and 4
+    int first = 0;
+    while (first < 5 && !ifstream(format(folder.c_str(), first)).good())
+        first++;
+    if (first == 5) {
+        cout << "Can not open the folder images " << folder << endl;
+        return false;
+    }
+    for (int i = first; ; i++) {
+        string file = format(folder.c_str(), i);
+        if (!ifstream(file).good())
+            break;
+        files.push_back(file);
+    }
+    return true;
+}
+
+/**
+* Hash of everything that changes the extracted features: the light pattern,
+* the preprocessing parameters and the descriptors
+* @param light_pattern light pattern used to preprocess the images
+* @return uint64_t hash used to validate the feature cache
+**/
+uint64_t preprocessParamsHash(Mat light_pattern) {
+    Mat pattern = light_pattern.isContinuous() ? light_pattern : light_pattern.clone();
+    uint64_t hash = FeatureCache::hash(&pattern.rows, sizeof(pattern.rows));
+    hash = FeatureCache::hash(&pattern.cols, sizeof(pattern.cols), hash);
+    hash = FeatureCache::hash(pattern.data, pattern.total() * pattern.elemSize(), hash);
+    hash = FeatureCache::hash(&binary_threshold, sizeof(binary_threshold), hash);
+    hash = FeatureCache::hash(&min_object_area, sizeof(min_object_area), hash);
+    hash = FeatureCache::hash(&part_descriptors, sizeof(part_descriptors), hash);
+    return hash;
+}
+
+/**
+* Folders of the training images with the label of each one
+* @return vector of folder patterns and labels
+**/
+vector<pair<string, int> > datasetFolders() {
+    // Nut, ring and screw images with their labels
+    vector<pair<string, int> > folders;
+    folders.push_back(make_pair(string("../data/nut/tuerca_%04d.pgm"), 0));
+    folders.push_back(make_pair(string("../data/ring/arandela_%04d.pgm"), 1));
+    folders.push_back(make_pair(string("../data/screw/tornillo_%04d.pgm"), 2));
+    return folders;
+}
+
+/**
+* Hash of the training set without reading the images: the path, size and
+* modification time of each image, its label and the preprocessing parameters
+* @param light_pattern light pattern used to preprocess the images
+* @return uint64_t hash stored with the trained model
+**/
+uint64_t trainingSetHash(Mat light_pattern) {
+    uint64_t hash = preprocessParamsHash(light_pattern);
+    hash = FeatureCache::hash(&num_for_test, sizeof(num_for_test), hash);
+    vector<pair<string, int> > folders = datasetFolders();
+    for (size_t f = 0; f < folders.size(); f++) {
+        vector<string> files;
+        listFolderImages(folders[f].first, files);
+        for (size_t i = 0; i < files.size(); i++) {
+            int64_t size = 0, mtime = 0;
+            FeatureCache::fileStat(files[i], size, mtime);
+            hash = FeatureCache::hash(files[i].data(), files[i].size(), hash);
+            hash = FeatureCache::hash(&size, sizeof(size), hash);
+            hash = FeatureCache::hash(&mtime, sizeof(mtime), hash);
+            hash = FeatureCache::hash(&folders[f].second, sizeof(folders[f].second), hash);
+        }
+    }
+    return hash;
+}
+/**
+* Read all images of all folders creating the train and test vectors.
+* Images are preprocessed and their features extracted in parallel, then the
+* results are gathered in the listed order so the data is the same as reading
+* each folder one image after another
+* @param folders vector of folder patterns with the label assigned to its train and test data
+* @param number of images of each folder used for test and evaluate algorithm error
+* @param trainingData vector where store all features for training
+* @param reponsesData vector where store all labels corresopinding for training data, in this case the label values
+* @param testData vector where store all features for test, this vector as the num_for_test size
+* @param testResponsesData vector where store all labels corresponiding for test, has the num_for_test size with label values
+* @param light_pattern light pattern used to preprocess the images
+* @param cache features of previous runs, only the images not found in it are processed, can be NULL
+* @return true if can read the folders images, false in error case
+**/
+bool readFolderAndExtractFeatures(vector<pair<string, int> > folders, int num_for_test,
+                                  PartFeatures &trainingData, vector<int> &responsesData,
+                                  PartFeatures &testData, vector<float> &testResponsesData,
+                                  Mat light_pattern, FeatureCache *cache) {
+    // List all images of all classes, with its label and its index in its folder
+    vector<string> files;
+    vector<int> labels, indexes;
+    for (size_t f = 0; f < folders.size(); f++) {
+        vector<string> folder_files;
+        if (!listFolderImages(folders[f].first, folder_files))
+            return false;
+        for (size_t i = 0; i < folder_files.size(); i++) {
+            files.push_back(folder_files[i]);
+            labels.push_back(folders[f].second);
+            indexes.push_back((int) i);
+        }
+    }
+
+    // Preprocess and extract the features of each image in the OpenCV thread pool,
+    // each image writes only in its own slot
+    int64 start = getTickCount();
+    vector<PartFeatures> image_features(files.size());
+    vector<uchar> computed(files.size(), 0);
+    parallel_for_(Range(0, (int) files.size()), [&](const Range &range) {
+        vector<float> rows;
+        for (int i = range.start; i < range.end; i++) {
+            // Reuse the features of the cache if the image has not changed
+            if (cache != NULL && cache->lookup(files[i], rows)) {
+                image_features[i].addRows(rows.data(), (int) rows.size() / num_features);
+                continue;
+            }
+            computed[i] = 1;
+            Mat frame = imread(files[i], IMREAD_GRAYSCALE);
+            if (frame.empty())
+                continue;
+            //// Preprocess image
+            Mat pre = preprocessImage(frame, light_pattern, threadWorkspace());
+            // Extract features
+            image_features[i] = ExtractFeatures(pre);
+        }
+    });
+    double elapsed = (getTickCount() - start) * 1000.0 / getTickFrequency();
+    int num_computed = (int) count(computed.begin(), computed.end(), 1);
+    cout << "Features of " << files.size() << " images extracted in " << elapsed << " ms using "
+         << getNumThreads() << " threads, " << files.size() - num_computed << " from the cache" << endl;
+
+    // Store the new features in the cache
+    if (cache != NULL && num_computed > 0) {
+        for (size_t img = 0; img < files.size(); img++) {
+            if (!computed[img])
+                continue;
+            PartFeatures &features = image_features[img];
+            cache->store(files[img], features.empty() ? NULL : features.row(0), features.size());
+        }
+        if (!cache->save())
+            cout << "Can not write the feature cache" << endl;
+    }
+
+    // Gather the results in the listed order, all the rows of an image go to train or test
+    for (size_t img = 0; img < files.size(); img++) {
+        PartFeatures &features = image_features[img];
+        if (indexes[img] >= num_for_test) {
+            trainingData.append(features);
+            responsesData.insert(responsesData.end(), features.size(), labels[img]);
+        } else {
+            testData.append(features);
+            testResponsesData.insert(testResponsesData.end(), features.size(), (float) labels[img]);
+        }
+    }
+    return true;
+}
+
+/**
+* Read the features of the nut, ring and screw images, using and updating the
+* feature cache
+* @param light_pattern light pattern used to preprocess the images
+* @param cache_file file of the feature cache, empty to disable it
+* @param trainingData table where store all features for training
+* @param reponsesData vector where store all labels corresopinding for training data
+* @param testData table where store all features for test
+* @param testResponsesData vector where store all labels corresponiding for test
+* @return true if can read the folders images, false in error case
+**/
+bool readPartsDataset(Mat light_pattern, string cache_file,
+                      PartFeatures &trainingData, vector<int> &responsesData,
+                      PartFeatures &testData, vector<float> &testResponsesData) {
+    // Features of previous runs, only the new or modified images are processed
+    shared_ptr<FeatureCache> cache;
+    if (!cache_file.empty()) {
+        cache = make_shared<FeatureCache>(cache_file, preprocessParamsHash(light_pattern), num_features);
+        cache->load();
+    }
+    // readFolderAndExtractFeatures 读取所有文件夹中的所有图像，并行提取特征
+    return readFolderAndExtractFeatures(datasetFolders(), num_for_test, trainingData, responsesData,
+                                        testData, testResponsesData, light_pattern, cache.get());
+}
+
+/**
+* Load the light pattern image and remove its noise
+* @param file light pattern image
+* @return Mat light pattern, empty in error case
+**/
+Mat loadLightPattern(string file) {
+    Mat light_pattern = imread(file, 0);
+    if (light_pattern.data == NULL)
+        return light_pattern;
+    medianBlur(light_pattern, light_pattern, 3);
+    return light_pattern;
+}
@@ -0,0 +1,130 @@
+/**
+ * Parts Dataset
+ *
+ * Preprocessing, feature extraction and loading of the nut, ring and screw
+ * images shared by the Chapter 6 applications, so all of them classify the
+ * same features.
+ *
+ */
+
+#ifndef PARTS_DATASET_h
+#define PARTS_DATASET_h
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <utility>
+using namespace std;
+
+// OpenCV includes
+#include "opencv2/core.hpp"
+using namespace cv;
+
+#include "MultipleImageWindow.h"
+#include "FeatureCache.h"
+#include "FeatureTable.h"
+#include "ShapeDescriptors.h"
+
+// Descriptors of each object used to classify it, selected at compile time
+#ifndef PART_DESCRIPTORS
+#define PART_DESCRIPTORS (SHAPE_AREA | SHAPE_ASPECT_RATIO)
+#endif
+
+// Preprocessing parameters, changing them invalidates the feature cache
+const int binary_threshold = 30;
+const float min_object_area = 500;
+const int part_descriptors = PART_DESCRIPTORS;
+typedef ShapeDescriptors<part_descriptors> PartDescriptors;
+const int num_features = PartDescriptors::num_features;
+// Table with a row of features for each object
+typedef FeatureTable<num_features> PartFeatures;
+// Number of images of each folder used to test the model
+const int num_for_test = 20;
+
+/**
+ * Buffers used to preprocess an image, reused by the following images of the
+ * same size so once they are sized preprocessing does not allocate memory.
+ * A workspace must be used by one thread at a time
+ */
+struct PreprocessWorkspace {
+    Mat gray, noise, img32, ratio, no_light, binary;
+    // Light pattern converted to float, converted again only if the pattern changes
+    Mat pattern, pattern32;
+};
+
+/**
+ * Workspace of the calling thread, the worker threads of the OpenCV pool keep
+ * their workspace between parallel loops
+ */
+PreprocessWorkspace &threadWorkspace();
+
+/**
+ * Extract the features for all objects in one image
+ */
+PartFeatures ExtractFeatures(Mat img, vector<int> *left = NULL, vector<int> *top = NULL,
+                             MultipleImageWindow *miw = NULL);
+
+/**
+ * Remove th light and return new image without light
+ */
+Mat removeLight(Mat img, Mat pattern);
+
+/**
+ * Remove the light in the buffers of a workspace, the result is valid until
+ * the workspace is used again
+ */
+Mat removeLight(Mat img, Mat pattern, PreprocessWorkspace &ws);
+
+/**
+ * Preprocess an input image to extract components and stats
+ */
+Mat preprocessImage(Mat input, Mat pattern);
+
+/**
+ * Preprocess an input image in the buffers of a workspace, the result is
+ * valid until the workspace is used again
+ */
+Mat preprocessImage(Mat input, Mat pattern, PreprocessWorkspace &ws);
+
+/**
+ * Load the light pattern image and remove its noise
+ */
+Mat loadLightPattern(string file);
+
+/**
+ * List the images of a folder sequence in the same order VideoCapture reads them
+ */
+bool listFolderImages(string folder, vector<string> &files);
+
+/**
+ * Folders of the training images with the label of each one
+ */
+vector<pair<string, int> > datasetFolders();
+
+/**
+ * Hash of everything that changes the extracted features
+ */
+uint64_t preprocessParamsHash(Mat light_pattern);
+
+/**
+ * Hash of the training set without reading the images
+ */
+uint64_t trainingSetHash(Mat light_pattern);
+
+/**
+ * Read all images of all folders creating the train and test vectors
+ */
+bool readFolderAndExtractFeatures(vector<pair<string, int> > folders, int num_for_test,
+                                  PartFeatures &trainingData, vector<int> &responsesData,
+                                  PartFeatures &testData, vector<float> &testResponsesData,
+                                  Mat light_pattern, FeatureCache *cache);
+
+/**
+ * Read the features of the nut, ring and screw images using the feature cache
+ */
+bool readPartsDataset(Mat light_pattern, string cache_file,
+                      PartFeatures &trainingData, vector<int> &responsesData,
+                      PartFeatures &testData, vector<float> &testResponsesData);
+
+
+#endif
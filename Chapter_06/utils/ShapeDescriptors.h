@@ -0,0 +1,188 @@
+/**
+ * Shape Descriptors
+ *
+ * Compute the descriptors of an object from its outer contour and the
+ * contours of its holes in a single traversal of their points, the area,
+ * centroid, perimeter and the spatial moments up to order 3 are accumulated
+ * edge by edge using the Green theorem.
+ *
+ * The descriptors used are selected at compile time with a mask of
+ * ShapeDescriptor values, the ones not selected are not computed and do
+ * not take space in the feature rows. Features are stored in the order of
+ * the ShapeDescriptor values, Hu moments use 7 features.
+ *
+ */
+
+#ifndef SHAPE_DESCRIPTORS_h
+#define SHAPE_DESCRIPTORS_h
+
+#include <vector>
+#include <cmath>
+using namespace std;
+
+// OpenCV includes
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+using namespace cv;
+
+enum ShapeDescriptor
+{
+    SHAPE_AREA= 1<<0,
+    SHAPE_ASPECT_RATIO= 1<<1,
+    SHAPE_PERIMETER= 1<<2,
+    SHAPE_CIRCULARITY= 1<<3,
+    SHAPE_SOLIDITY= 1<<4,
+    SHAPE_HOLES= 1<<5,
+    SHAPE_HU_MOMENTS= 1<<6
+};
+
+/**
+ * Accumulated values of a contour traversal
+ */
+struct ContourSums
+{
+    double a00, a10, a01, a20, a11, a02, a30, a21, a12, a03;
+    double perimeter;
+};
+
+/**
+ * Traverse the points of a contour once accumulating its perimeter and, if
+ * required, the terms of its spatial moments
+ * @param contour points of the contour
+ * @param sums output of the accumulated values, added to the previous ones with the sign
+ * @param sign 1 for the outer contour, -1 for the holes
+ */
+template<bool HigherMoments>
+void accumulateContour(const vector<Point> &contour, ContourSums &sums, double sign)
+{
+    size_t n= contour.size();
+    if(n==0)
+        return;
+    double a00= 0, a10= 0, a01= 0, a20= 0, a11= 0, a02= 0, a30= 0, a21= 0, a12= 0, a03= 0;
+    double perimeter= 0;
+    double xi_1= contour[n-1].x, yi_1= contour[n-1].y;
+    for(size_t i=0; i<n; i++){
+        double xi= contour[i].x, yi= contour[i].y;
+        double dx= xi-xi_1, dy= yi-yi_1;
+        perimeter+= sqrt(dx*dx+dy*dy);
+        double dxy= xi_1*yi-xi*yi_1;
+        double xii_1= xi_1+xi;
+        double yii_1= yi_1+yi;
+        a00+= dxy;
+        a10+= dxy*xii_1;
+        a01+= dxy*yii_1;
+        if(HigherMoments){
+            double xi2= xi*xi, yi2= yi*yi, xi_12= xi_1*xi_1, yi_12= yi_1*yi_1;
+            a20+= dxy*(xi_1*xii_1+xi2);
+            a11+= dxy*(xi_1*(yii_1+yi_1)+xi*(yii_1+yi));
+            a02+= dxy*(yi_1*yii_1+yi2);
+            a30+= dxy*xii_1*(xi_12+xi2);
+            a03+= dxy*yii_1*(yi_12+yi2);
+            a21+= dxy*(xi_12*(3*yi_1+yi)+2*xi*xi_1*yii_1+xi2*(yi_1+3*yi));
+            a12+= dxy*(yi_12*(3*xi_1+xi)+2*yi*yi_1*xii_1+yi2*(xi_1+3*xi));
+        }
+        xi_1= xi;
+        yi_1= yi;
+    }
+    // The orientation of the contour gives the sign of the sums
+    if(a00<0)
+        sign= -sign;
+    sums.a00+= sign*a00; sums.a10+= sign*a10; sums.a01+= sign*a01;
+    sums.a20+= sign*a20; sums.a11+= sign*a11; sums.a02+= sign*a02;
+    sums.a30+= sign*a30; sums.a21+= sign*a21; sums.a12+= sign*a12; sums.a03+= sign*a03;
+    sums.perimeter+= perimeter;
+}
+
+template<int Set>
+class ShapeDescriptors
+{
+    public:
+        enum {
+            num_features= ((Set & SHAPE_AREA)?1:0)+((Set & SHAPE_ASPECT_RATIO)?1:0)+
+                          ((Set & SHAPE_PERIMETER)?1:0)+((Set & SHAPE_CIRCULARITY)?1:0)+
+                          ((Set & SHAPE_SOLIDITY)?1:0)+((Set & SHAPE_HOLES)?1:0)+
+                          ((Set & SHAPE_HU_MOMENTS)?7:0)
+        };
+
+        /**
+         * Name of each feature, used to check saved models
+         * @param int i feature index
+         * @return string name of the feature
+         */
+        static string featureName(int i)
+        {
+            const char *hu_names[7]= {"hu1", "hu2", "hu3", "hu4", "hu5", "hu6", "hu7"};
+            vector<string> names;
+            if(Set & SHAPE_AREA) names.push_back("area");
+            if(Set & SHAPE_ASPECT_RATIO) names.push_back("aspect_ratio");
+            if(Set & SHAPE_PERIMETER) names.push_back("perimeter");
+            if(Set & SHAPE_CIRCULARITY) names.push_back("circularity");
+            if(Set & SHAPE_SOLIDITY) names.push_back("solidity");
+            if(Set & SHAPE_HOLES) names.push_back("holes");
+            if(Set & SHAPE_HU_MOMENTS) names.insert(names.end(), hu_names, hu_names+7);
+            return names[i];
+        }
+
+        /**
+         * Compute the descriptors of an object
+         *
+         * @param contours all contours found with RETR_CCOMP
+         * @param hierarchy hierarchy of the contours
+         * @param index index of the outer contour of the object
+         * @param min_area objects with smaller area are discarded
+         * @param row output of num_features descriptors
+         * @param center output of the centroid of the object
+         * @return bool false if the object is discarded
+         */
+        static bool compute(const vector<vector<Point> > &contours, const vector<Vec4i> &hierarchy,
+                            int index, float min_area, float *row, Point2f *center)
+        {
+            const bool higher_moments= (Set & SHAPE_HU_MOMENTS)!=0;
+            ContourSums sums= ContourSums();
+            accumulateContour<higher_moments>(contours[index], sums, 1);
+            // Holes are the children of the outer contour
+            int holes= 0;
+            for(int h= hierarchy[index][2]; h>=0; h= hierarchy[h][0]){
+                accumulateContour<higher_moments>(contours[h], sums, -1);
+                holes++;
+            }
+            double area= sums.a00*0.5;
+            if(area<=min_area)
+                return false;
+            if(center!=NULL)
+                *center= Point2f((float)(sums.a10/(6*area)), (float)(sums.a01/(6*area)));
+
+            int f= 0;
+            if(Set & SHAPE_AREA)
+                row[f++]= (float)area;
+            if(Set & SHAPE_ASPECT_RATIO){
+                RotatedRect r= minAreaRect(contours[index]);
+                float width= r.size.width;
+                float height= r.size.height;
+                row[f++]= (width<height)?height/width:width/height;
+            }
+            if(Set & SHAPE_PERIMETER)
+                row[f++]= (float)sums.perimeter;
+            if(Set & SHAPE_CIRCULARITY)
+                row[f++]= (float)(4*CV_PI*area/(sums.perimeter*sums.perimeter));
+            if(Set & SHAPE_SOLIDITY){
+                vector<Point> hull;
+                convexHull(contours[index], hull);
+                row[f++]= (float)(area/contourArea(hull));
+            }
+            if(Set & SHAPE_HOLES)
+                row[f++]= (float)holes;
+            if(Set & SHAPE_HU_MOMENTS){
+                Moments m(sums.a00/2, sums.a10/6, sums.a01/6, sums.a20/12, sums.a11/24, sums.a02/12,
+                          sums.a30/20, sums.a21/60, sums.a12/60, sums.a03/20);
+                double hu[7];
+                HuMoments(m, hu);
+                for(int i=0; i<7; i++)
+                    row[f++]= (float)hu[i];
+            }
+            return true;
+        }
+};
+
+
+#endif
@@ -0,0 +1,218 @@
+#include "StripExtractor.h"
+
+#include <algorithm>
+
+// OpenCV includes
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace {
+
+// Rows of the neighbour strips used by the 3x3 median filter
+const int strip_halo = 1;
+
+/**
+ * Object that touches the boundary of its strip, with its label in the strip
+ */
+struct BorderPiece {
+    int label;
+    Rect box;
+};
+
+/**
+ * Objects of a strip: the ones described in the strip, the pieces to stitch
+ * and the labels of the first and last rows
+ */
+struct StripResult {
+    PartFeatures features;
+    vector<Point> centers;
+    vector<BorderPiece> pieces;
+    vector<int> first_row, last_row;
+};
+
+/**
+ * Buffers of each thread, reused by all the strips it processes
+ */
+struct StripBuffers {
+    Mat rows, contours_input, labels;
+    vector<vector<Point> > contours;
+    vector<Vec4i> hierarchy;
+};
+
+StripBuffers &threadBuffers() {
+    static thread_local StripBuffers buffers;
+    return buffers;
+}
+
+/**
+ * Binary image of a region, the same as the region of the whole preprocessed image
+ */
+Mat preprocessRegion(Mat img, Mat pattern, Rect region, StripBuffers &buffers) {
+    Rect outer = Rect(region.x - strip_halo, region.y - strip_halo,
+                      region.width + 2 * strip_halo, region.height + 2 * strip_halo) & Rect(0, 0, img.cols, img.rows);
+    // Copy the rows so the median filter replicates the image borders as in the whole image
+    img(outer).copyTo(buffers.rows);
+    Mat binary = preprocessImage(buffers.rows, pattern(outer), threadWorkspace());
+    return binary(Rect(region.x - outer.x, region.y - outer.y, region.width, region.height));
+}
+
+int findRoot(vector<int> &parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+void join(vector<int> &parent, int a, int b) {
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a < b)
+        parent[b] = a;
+    else if (b < a)
+        parent[a] = b;
+}
+
+/**
+ * Describe the strip objects that do not touch its boundaries with other
+ * strips and keep the label and box of the ones that touch them
+ */
+void processStrip(Mat img, Mat pattern, int y0, int y1, StripResult &result) {
+    StripBuffers &buffers = threadBuffers();
+    Mat binary = preprocessRegion(img, pattern, Rect(0, y0, img.cols, y1 - y0), buffers);
+    binary.copyTo(buffers.contours_input);
+    findContours(buffers.contours_input, buffers.contours, buffers.hierarchy, RETR_CCOMP, CHAIN_APPROX_SIMPLE);
+    connectedComponents(binary, buffers.labels, 8, CV_32S);
+
+    bool first = y0 == 0, last = y1 == img.rows;
+    float row[num_features];
+    for (size_t i = 0; i < buffers.contours.size(); i++) {
+        if (buffers.hierarchy[i][3] >= 0)
+            continue;
+        Rect box = boundingRect(buffers.contours[i]);
+        if ((box.y == 0 && !first) || (box.y + box.height == binary.rows && !last)) {
+            BorderPiece piece;
+            piece.label = buffers.labels.at<int>(buffers.contours[i][0]);
+            piece.box = box + Point(0, y0);
+            result.pieces.push_back(piece);
+            continue;
+        }
+        Point2f center;
+        if (!PartDescriptors::compute(buffers.contours, buffers.hierarchy, (int) i, min_object_area, row, &center))
+            continue;
+        result.features.addRows(row, 1);
+        result.centers.push_back(Point((int) center.x, (int) center.y + y0));
+    }
+    const int *first_labels = buffers.labels.ptr<int>(0);
+    const int *last_labels = buffers.labels.ptr<int>(buffers.labels.rows - 1);
+    result.first_row.assign(first_labels, first_labels + img.cols);
+    result.last_row.assign(last_labels, last_labels + img.cols);
+}
+
+}
+
+PartFeatures ExtractFeaturesInStrips(Mat img, Mat pattern, int strip_rows, vector<int> *left, vector<int> *top) {
+    if (img.channels() == 3)
+        cvtColor(img, img, COLOR_RGB2GRAY);
+    int num_strips = (img.rows + strip_rows - 1) / strip_rows;
+    vector<StripResult> strips(num_strips);
+    parallel_for_(Range(0, num_strips), [&](const Range &range) {
+        for (int s = range.start; s < range.end; s++)
+            processStrip(img, pattern, s * strip_rows, min(img.rows, (s + 1) * strip_rows), strips[s]);
+    });
+
+    // Join the pieces whose pixels touch across a boundary, the labels of
+    // each strip are indexed after the labels of the previous strips
+    vector<int> offset(num_strips + 1, 0);
+    for (int s = 0; s < num_strips; s++) {
+        int num_labels = 0;
+        for (size_t p = 0; p < strips[s].pieces.size(); p++)
+            num_labels = max(num_labels, strips[s].pieces[p].label + 1);
+        offset[s + 1] = offset[s] + num_labels;
+    }
+    vector<int> parent(offset[num_strips]);
+    for (size_t i = 0; i < parent.size(); i++)
+        parent[i] = (int) i;
+    for (int s = 1; s < num_strips; s++) {
+        const vector<int> &above = strips[s - 1].last_row;
+        const vector<int> &below = strips[s].first_row;
+        for (int x = 0; x < img.cols; x++) {
+            if (below[x] == 0)
+                continue;
+            for (int dx = max(0, x - 1); dx <= min(img.cols - 1, x + 1); dx++) {
+                if (above[dx] != 0)
+                    join(parent, offset[s] + below[x], offset[s - 1] + above[dx]);
+            }
+        }
+    }
+
+    // Bounding box of each stitched object, in the order of its first piece
+    vector<int> object_index(parent.size(), -1);
+    vector<Rect> boxes;
+    for (int s = 0; s < num_strips; s++) {
+        for (size_t p = 0; p < strips[s].pieces.size(); p++) {
+            const BorderPiece &piece = strips[s].pieces[p];
+            int root = findRoot(parent, offset[s] + piece.label);
+            if (object_index[root] < 0) {
+                object_index[root] = (int) boxes.size();
+                boxes.push_back(piece.box);
+            } else {
+                boxes[object_index[root]] |= piece.box;
+            }
+        }
+    }
+
+    // Describe each stitched object in its bounding box, its outer contour is
+    // the one that fills the box
+    vector<PartFeatures> stitched(boxes.size());
+    vector<Point> stitched_centers(boxes.size());
+    parallel_for_(Range(0, (int) boxes.size()), [&](const Range &range) {
+        StripBuffers &buffers = threadBuffers();
+        float row[num_features];
+        for (int b = range.start; b < range.end; b++) {
+            Mat binary = preprocessRegion(img, pattern, boxes[b], buffers);
+            binary.copyTo(buffers.contours_input);
+            findContours(buffers.contours_input, buffers.contours, buffers.hierarchy, RETR_CCOMP,
+                         CHAIN_APPROX_SIMPLE);
+            int best = -1;
+            double best_area = 0;
+            for (size_t i = 0; i < buffers.contours.size(); i++) {
+                if (buffers.hierarchy[i][3] >= 0 || boundingRect(buffers.contours[i]).size() != boxes[b].size())
+                    continue;
+                double area = contourArea(buffers.contours[i]);
+                if (best < 0 || area > best_area) {
+                    best = (int) i;
+                    best_area = area;
+                }
+            }
+            Point2f center;
+            if (best < 0 ||
+                !PartDescriptors::compute(buffers.contours, buffers.hierarchy, best, min_object_area, row, &center))
+                continue;
+            stitched[b].addRows(row, 1);
+            stitched_centers[b] = Point((int) center.x + boxes[b].x, (int) center.y + boxes[b].y);
+        }
+    });
+
+    // Gather the objects of the strips and then the stitched ones
+    PartFeatures output;
+    for (int s = 0; s < num_strips; s++) {
+        output.append(strips[s].features);
+        for (size_t i = 0; i < strips[s].centers.size(); i++) {
+            if (left != NULL)
+                left->push_back(strips[s].centers[i].x);
+            if (top != NULL)
+                top->push_back(strips[s].centers[i].y);
+        }
+    }
+    for (size_t b = 0; b < boxes.size(); b++) {
+        if (stitched[b].empty())
+            continue;
+        output.append(stitched[b]);
+        if (left != NULL)
+            left->push_back(stitched_centers[b].x);
+        if (top != NULL)
+            top->push_back(stitched_centers[b].y);
+    }
+    return output;
+}
@@ -0,0 +1,44 @@
+/**
+ * Strip Extractor
+ *
+ * Extract the features of the objects of very large images, as the ones of
+ * a line scan camera, processing horizontal strips in parallel so the
+ * preprocessing buffers, contours and labels only take the size of a strip
+ * for each thread.
+ *
+ * Each strip is preprocessed with one halo row of its neighbours, required
+ * by the median filter, so its binary rows are the same as preprocessing the
+ * whole image. The objects inside a strip are described in the strip, the
+ * objects that touch the boundary with a neighbour strip are stitched by
+ * comparing the labels of the boundary rows with 8 connectivity, then each
+ * stitched object is preprocessed and described again in its bounding box.
+ *
+ */
+
+#ifndef STRIP_EXTRACTOR_h
+#define STRIP_EXTRACTOR_h
+
+#include <vector>
+using namespace std;
+
+// OpenCV includes
+#include "opencv2/core.hpp"
+using namespace cv;
+
+#include "PartsDataset.h"
+
+/**
+ * Extract the features of all objects of an image processed in strips
+ * @param Mat img input image
+ * @param Mat pattern light pattern of the same size as the image
+ * @param int strip_rows number of rows of each strip
+ * @param vector<int> left output of left coordinates for each object
+ * @param vector<int> top output of top coordinates for each object
+ * @return PartFeatures a table with a row of features for each object, the
+ * objects inside a strip in strip order and then the stitched ones
+ */
+PartFeatures ExtractFeaturesInStrips(Mat img, Mat pattern, int strip_rows,
+                                     vector<int> *left = NULL, vector<int> *top = NULL);
+
+
+#endif
@@ -0,0 +1,116 @@
+// CASCADE CACHE
+// Write the cache of the cascades used by the applications and compare the
+// time to load them from their XML and from the cache
+
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "opencv2/objdetect/objdetect.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sys/stat.h>
+
+#include "utils/CascadeCache.h"
+
+using namespace cv;
+using namespace std;
+
+const char *keys =
+        {
+                "{help h usage ? | | print this message}"
+                "{@input | ../resources | Cascade XML file, or directory whose XML files are cached}"
+                "{runs | 5 | Number of loads of each cascade to time}"
+                "{image | | Image where check that the cascades of the XML and of the cache find the same objects}"
+        };
+
+static double fileKB(const string &file) {
+    struct stat info;
+    return stat(file.c_str(), &info) == 0 ? info.st_size / 1024.0 : 0;
+}
+
+/**
+ * Mean time to load a cascade runs times
+ */
+static double loadMs(const string &xmlFile, bool cache, int runs, bool &fromCache) {
+    int64 start = getTickCount();
+    for (int r = 0; r < runs; r++) {
+        CascadeClassifier cascade;
+        if (cache)
+            loadCascade(cascade, xmlFile, "", &fromCache);
+        else
+            cascade.load(xmlFile);
+    }
+    return (getTickCount() - start) * 1000.0 / getTickFrequency() / runs;
+}
+
+int main(int argc, char *argv[]) {
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 7. Cascade cache v1.0.0");
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+    string input = parser.get<string>("@input");
+    int runs = max(1, parser.get<int>("runs"));
+    string imageFile = parser.get<string>("image");
+    if (!parser.check()) {
+        parser.printErrors();
+        return 0;
+    }
+
+    vector<String> xmlFiles;
+    struct stat info;
+    if (stat(input.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+        glob(input + "/*.xml", xmlFiles, false);
+    else
+        xmlFiles.push_back(input);
+
+    Mat image;
+    if (!imageFile.empty()) {
+        image = imread(imageFile, IMREAD_GRAYSCALE);
+        if (image.empty()) {
+            cerr << "Error loading image " << imageFile << ". Exiting!" << endl;
+            return -1;
+        }
+        equalizeHist(image, image);
+    }
+
+    cout << fixed << setprecision(2);
+    cout << left << setw(36) << "Cascade" << right << setw(10) << "XML KB" << setw(10) << "Cache KB"
+         << setw(10) << "XML ms" << setw(10) << "Cache ms" << setw(10) << "Speedup" << endl;
+    int errors = 0;
+    for (auto &xmlFile: xmlFiles) {
+        string cacheFile = cascadeCacheFile(xmlFile);
+        if (!writeCascadeCache(xmlFile, cacheFile)) {
+            cerr << "Error writing the cache of " << xmlFile << endl;
+            errors++;
+            continue;
+        }
+        bool fromCache = false;
+        double xmlMs = loadMs(xmlFile, false, runs, fromCache);
+        double cacheMs = loadMs(xmlFile, true, runs, fromCache);
+        string name = xmlFile.substr(xmlFile.find_last_of("/\\") + 1);
+        cout << left << setw(36) << name << right << setw(10) << fileKB(xmlFile) << setw(10) << fileKB(cacheFile)
+             << setw(10) << xmlMs << setw(10) << cacheMs << setw(10) << xmlMs / cacheMs << endl;
+        if (!fromCache) {
+            cerr << "  the cache of " << name << " can not be loaded" << endl;
+            errors++;
+            continue;
+        }
+
+        // Both cascades must find the same objects
+        if (!image.empty()) {
+            CascadeClassifier xmlCascade, cacheCascade;
+            xmlCascade.load(xmlFile);
+            loadCascade(cacheCascade, xmlFile);
+            vector<Rect> xmlObjects, cacheObjects;
+            xmlCascade.detectMultiScale(image, xmlObjects, 1.1, 2, 0, Size(30, 30));
+            cacheCascade.detectMultiScale(image, cacheObjects, 1.1, 2, 0, Size(30, 30));
+            bool same = xmlObjects == cacheObjects;
+            cout << "  " << xmlObjects.size() << " objects in the image, "
+                 << (same ? "same as the XML" : "DIFFERENT from the XML") << endl;
+            if (!same)
+                errors++;
+        }
+    }
+    return errors == 0 ? 0 : -1;
+}
@@ -5,20 +5,66 @@
 #include "opencv2/objdetect/objdetect.hpp"
 #include <iostream>
 
+#include "utils/CascadeCache.h"
+#include "utils/FaceTracker.h"
+#include "utils/FrameSource.h"
+#include "utils/MultiCascadeDetector.h"
+
 using namespace cv;
 using namespace std;
 
+const char *keys =
+        {
+                "{help h usage ? | | print this message}"
+                "{@leftEarCascade | | Left ear cascade file}"
+                "{@rightEarCascade | | Right ear cascade file}"
+                "{detect_every | 5 | Run the detector every N frames and track between them, 1 detects in all frames}"
+                "{compare | | Also run the two cascades independently in each frame and compare the time and the ears with the shared pyramid}"
+                FRAME_SOURCE_KEYS
+        };
+
+/**
+ * Ears of a detection also found by the other one, with an IoU over 0.5
+ */
+static int matchedEars(const vector<Rect> &ears, const vector<Rect> &others) {
+    int matched = 0;
+    for (auto &ear: ears) {
+        for (auto &other: others) {
+            double iou = (double) (ear & other).area() / (ear | other).area();
+            if (iou > 0.5) {
+                matched++;
+                break;
+            }
+        }
+    }
+    return matched;
+}
+
 int main(int argc, char *argv[]) {
-    string leftEarCascadeName = argv[1];
-    string rightEarCascadeName = argv[2];
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 7. Ear detector v1.0.0");
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+    string leftEarCascadeName = parser.get<string>("@leftEarCascade");
+    string rightEarCascadeName = parser.get<string>("@rightEarCascade");
+    int detectEvery = parser.get<int>("detect_every");
+    bool compare = parser.has("compare");
+    if (!parser.check()) {
+        parser.printErrors();
+        return 0;
+    }
     CascadeClassifier leftEarCascade, rightEarCascade;
+    // Both ears with a single pyramid, the left ones are objects[0] and the right ones objects[1]
+    MultiCascadeDetector earDetector(1.1, 2, Size(30, 30));
 
-    if (!leftEarCascade.load(leftEarCascadeName)) {
+    if (!loadCascade(leftEarCascade, leftEarCascadeName) || !earDetector.add(leftEarCascadeName)) {
         cerr << "Error loading left ear cascade file. Exiting!" << endl;
         return -1;
     }
 
-    if (!rightEarCascade.load(rightEarCascadeName)) {
+    if (!loadCascade(rightEarCascade, rightEarCascadeName) || !earDetector.add(rightEarCascadeName)) {
         cerr << "Error loading right ear cascade file. Exiting!" << endl;
         return -1;
     }
@@ -26,13 +72,14 @@ int main(int argc, char *argv[]) {
     // Current frame
     Mat frame, frameGray;
 
-    // Create the capture object
-    // 0 -> input arg that specifies it should take the input from the webcam
-    VideoCapture cap(0);
+    // Create the capture object, the webcam or the input to replay
+    FrameSource cap;
 
     // If you cannot open the webcam, stop the execution!
-    if (!cap.isOpened())
+    if (!cap.open(parser)) {
+        cerr << "Error opening the input. Exiting!" << endl;
         return -1;
+    }
 
     //create GUI windows
     namedWindow("Frame");
@@ -40,12 +87,40 @@ int main(int argc, char *argv[]) {
     // Scaling factor to resize the input frames from the webcam
     float scalingFactor = 0.75;
 
+    // Both trackers share the detection of the frame, the first one that needs it runs it
+    int frameIndex = 0, detectedFrame = -1;
+    vector<vector<Rect> > ears;
+    auto detectEars = [&](const Mat &gray) {
+        if (detectedFrame != frameIndex) {
+            earDetector.detect(gray, ears);
+            detectedFrame = frameIndex;
+        }
+    };
+
+    // Detect the ears every detectEvery frames and track them in between
+    FaceTracker leftEarTracker([&](const Mat &gray, vector<Rect> &objects) {
+        detectEars(gray);
+        objects = ears[0];
+    }, detectEvery);
+    FaceTracker rightEarTracker([&](const Mat &gray, vector<Rect> &objects) {
+        detectEars(gray);
+        objects = ears[1];
+    }, detectEvery);
+
     vector<Rect> leftEars, rightEars;
 
+    // With --compare, time of the two independent calls and of the shared pyramid, and the ears
+    // of each cascade found by one of them and not by the other
+    double independentMs = 0, sharedMs = 0;
+    int compared = 0, independentEars = 0, sharedEars = 0;
+    int onlyIndependent[2] = {0, 0}, onlyShared[2] = {0, 0};
+
     // Iterate until the user presses the Esc key
     while (true) {
         // Capture the current frame
         cap >> frame;
+        if (frame.empty())
+            break;
 
         // Resize the frame
         resize(frame, frame, Size(), scalingFactor, scalingFactor, INTER_AREA);
@@ -56,11 +131,31 @@ int main(int argc, char *argv[]) {
         // Equalize the histogram
         equalizeHist(frameGray, frameGray);
 
-        // Detect left ear
-        leftEarCascade.detectMultiScale(frameGray, leftEars, 1.1, 2, 0 | 2, Size(30, 30));
+        if (compare) {
+            vector<Rect> leftAlone, rightAlone;
+            vector<vector<Rect> > shared;
+            int64 start = getTickCount();
+            leftEarCascade.detectMultiScale(frameGray, leftAlone, 1.1, 2, 0 | 2, Size(30, 30));
+            rightEarCascade.detectMultiScale(frameGray, rightAlone, 1.1, 2, 0 | 2, Size(30, 30));
+            independentMs += (getTickCount() - start) * 1000.0 / getTickFrequency();
+            start = getTickCount();
+            earDetector.detect(frameGray, shared);
+            sharedMs += (getTickCount() - start) * 1000.0 / getTickFrequency();
+            compared++;
+            const vector<Rect> *alone[2] = {&leftAlone, &rightAlone};
+            for (int c = 0; c < 2; c++) {
+                independentEars += (int) alone[c]->size();
+                sharedEars += (int) shared[c].size();
+                onlyIndependent[c] += (int) alone[c]->size() - matchedEars(*alone[c], shared[c]);
+                onlyShared[c] += (int) shared[c].size() - matchedEars(shared[c], *alone[c]);
+            }
+        }
+
+        // Detect or track left ear
+        leftEars = leftEarTracker.update(frameGray);
 
-        // Detect right ear
-        rightEarCascade.detectMultiScale(frameGray, rightEars, 1.1, 2, 0 | 2, Size(30, 30));
+        // Detect or track right ear
+        rightEars = rightEarTracker.update(frameGray);
 
         // Draw green rectangle around the left ear
         for (auto &leftEar: leftEars) {
@@ -79,12 +174,28 @@ int main(int argc, char *argv[]) {
 
         // Get the keyboard input and check if it's 'Esc'
         // 27 -> ASCII value of 'Esc' key
-        auto ch = waitKey(30);
+        auto ch = waitKey(cap.waitDelay(30));
         if (ch == 27) {
             break;
         }
+        frameIndex++;
     }
 
+    if (compared > 0) {
+        cout << "Independent cascades: " << independentMs / compared << " ms/frame" << endl;
+        cout << "Shared pyramid: " << sharedMs / compared << " ms/frame, " << earDetector.getLevels()
+             << " levels, " << earDetector.getEvaluations() << " cascade evaluations" << endl;
+        cout << "Saving: " << 100.0 * (1 - sharedMs / independentMs) << "%" << endl;
+        cout << "Ears: " << independentEars << " independent, " << sharedEars << " shared; not matched (IoU over 0.5): "
+             << "left " << onlyIndependent[0] << " only independent, " << onlyShared[0] << " only shared, "
+             << "right " << onlyIndependent[1] << " only independent, " << onlyShared[1] << " only shared" << endl;
+    }
+
+    cout << "Left ears: " << leftEarTracker.report() << endl;
+    cout << "Right ears: " << rightEarTracker.report() << endl;
+
+    cout << cap.report() << endl;
+
     // Release the video capture object
     cap.release();
 
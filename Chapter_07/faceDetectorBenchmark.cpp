@@ -0,0 +1,240 @@
+// FACE DETECTOR BENCHMARK
+// Run every face detector backend over the same images at several
+// resolutions and compare their latency and the faces they find
+
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "opencv2/objdetect/objdetect.hpp"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "utils/FaceDetector.h"
+
+using namespace cv;
+using namespace std;
+
+const char *keys =
+        {
+                "{help h usage ? | | print this message}"
+                "{@images | | Glob of the images, as 'faces/*.jpg'}"
+                "{backends | haar,lbp,dnn | Comma separated backends to compare}"
+                "{haar | ../resources/haarcascade_frontalface_alt.xml | Haar face cascade}"
+                "{lbp | ../resources/lbpcascade_frontalface_improved.xml | LBP face cascade}"
+                "{dnn_model | ../../Chapter_12/data/res10_300x300_ssd_iter_140000.caffemodel | Weights of the dnn face detector}"
+                "{dnn_config | ../../Chapter_12/data/deploy.prototxt.txt | Network configuration of the dnn face detector}"
+                "{min_confidence | 0.5 | Minimum confidence of the faces of the dnn face detector}"
+                "{widths | 320,640,1280 | Comma separated widths the images are resized to}"
+                "{runs | 3 | Number of detections of each image to time}"
+                "{annotations | | File with a face per line: image name, x, y, width and height, else the faces of the reference are used}"
+                "{reference | dnn | Backend whose faces at the largest width are the ground truth without annotations}"
+        };
+
+/**
+ * Comma separated values of a key
+ */
+static vector<string> splitList(const string &list) {
+    vector<string> values;
+    stringstream stream(list);
+    string value;
+    while (getline(stream, value, ','))
+        if (!value.empty())
+            values.push_back(value);
+    return values;
+}
+
+/**
+ * Name of an image without its directory
+ */
+static string baseName(const string &file) {
+    return file.substr(file.find_last_of("/\\") + 1);
+}
+
+/**
+ * Faces of each image of the annotations file
+ */
+static bool readAnnotations(const string &file, map<string, vector<Rect> > &annotations) {
+    ifstream in(file.c_str());
+    if (!in)
+        return false;
+    string name;
+    Rect face;
+    while (in >> name >> face.x >> face.y >> face.width >> face.height)
+        annotations[baseName(name)].push_back(face);
+    return true;
+}
+
+/**
+ * Faces of the truth found by the detector with an IoU over 0.5
+ */
+static int matchedFaces(const vector<Rect> &truth, const vector<Rect> &found) {
+    int matched = 0;
+    for (auto &face: truth) {
+        for (auto &other: found) {
+            double iou = (double) (face & other).area() / (face | other).area();
+            if (iou > 0.5) {
+                matched++;
+                break;
+            }
+        }
+    }
+    return matched;
+}
+
+/**
+ * Image resized to a width, and its gray and equalized version, as the applications prepare their frames
+ */
+static double prepareImage(const Mat &image, int width, Mat &resized, Mat &gray) {
+    double scale = (double) width / image.cols;
+    resize(image, resized, Size(), scale, scale, scale < 1 ? INTER_AREA : INTER_LINEAR);
+    cvtColor(resized, gray, COLOR_BGR2GRAY);
+    equalizeHist(gray, gray);
+    return scale;
+}
+
+/**
+ * The network was trained with color images, it gets the color image; the cascades get the gray one
+ */
+static const Mat &detectorInput(const FaceDetector &detector, const Mat &color, const Mat &gray) {
+    return detector.name == "dnn" ? color : gray;
+}
+
+/**
+ * Detect the faces of an image, in the coordinates of the original image
+ * @return mean time of a detection in ms
+ */
+static double detectFaces(FaceDetector &detector, const Mat &image, double scale, int runs, vector<Rect> &faces) {
+    int64 start = getTickCount();
+    for (int r = 0; r < runs; r++)
+        detector.detect(image, faces);
+    double ms = (getTickCount() - start) * 1000.0 / getTickFrequency() / runs;
+    for (auto &face: faces)
+        face = Rect(cvRound(face.x / scale), cvRound(face.y / scale), cvRound(face.width / scale),
+                    cvRound(face.height / scale));
+    return ms;
+}
+
+int main(int argc, char *argv[]) {
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 7. Face detector benchmark v1.0.0");
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+    string images = parser.get<string>("@images");
+    vector<string> backends = splitList(parser.get<string>("backends"));
+    vector<string> widthList = splitList(parser.get<string>("widths"));
+    int runs = max(1, parser.get<int>("runs"));
+    string annotationsFile = parser.get<string>("annotations");
+    string reference = parser.get<string>("reference");
+    double minConfidence = parser.get<double>("min_confidence");
+    if (!parser.check()) {
+        parser.printErrors();
+        return 0;
+    }
+
+    vector<String> files;
+    if (!images.empty())
+        glob(images, files, false);
+    vector<Mat> frames;
+    vector<string> names;
+    for (auto &file: files) {
+        Mat image = imread(file);
+        if (!image.empty()) {
+            frames.push_back(image);
+            names.push_back(baseName(file));
+        }
+    }
+    if (frames.empty()) {
+        cerr << "No images to detect, give a glob of them. Exiting!" << endl;
+        return -1;
+    }
+
+    vector<int> widths;
+    for (auto &width: widthList)
+        if (atoi(width.c_str()) > 0)
+            widths.push_back(atoi(width.c_str()));
+    if (widths.empty()) {
+        cerr << "No widths to resize the images to. Exiting!" << endl;
+        return -1;
+    }
+
+    // Load every backend, the ones whose files are missing are skipped
+    vector<Ptr<FaceDetector> > detectors;
+    for (auto &backend: backends) {
+        string model = parser.get<string>(backend == "dnn" ? "dnn_model" : backend == "lbp" ? "lbp" : "haar");
+        Ptr<FaceDetector> detector = createFaceDetector(backend, model, parser.get<string>("dnn_config"),
+                                                        minConfidence);
+        if (detector.empty())
+            cerr << "Error loading the " << backend << " face detector, skipped" << endl;
+        else
+            detectors.push_back(detector);
+    }
+    if (detectors.empty()) {
+        cerr << "No face detector could be loaded. Exiting!" << endl;
+        return -1;
+    }
+
+    // Ground truth of each image, annotated or found by the reference at the largest width
+    vector<vector<Rect> > truth(frames.size());
+    string truthName;
+    if (!annotationsFile.empty()) {
+        map<string, vector<Rect> > annotations;
+        if (!readAnnotations(annotationsFile, annotations)) {
+            cerr << "Error reading the annotations. Exiting!" << endl;
+            return -1;
+        }
+        for (size_t i = 0; i < frames.size(); i++)
+            truth[i] = annotations[names[i]];
+        truthName = annotationsFile;
+    } else {
+        Ptr<FaceDetector> referenceDetector;
+        for (auto &detector: detectors)
+            if (detector->name == reference)
+                referenceDetector = detector;
+        if (referenceDetector.empty()) {
+            cerr << "The reference backend " << reference << " is not loaded. Exiting!" << endl;
+            return -1;
+        }
+        int maxWidth = *max_element(widths.begin(), widths.end());
+        for (size_t i = 0; i < frames.size(); i++) {
+            Mat color, gray;
+            double scale = prepareImage(frames[i], maxWidth, color, gray);
+            detectFaces(*referenceDetector, detectorInput(*referenceDetector, color, gray), scale, 1, truth[i]);
+        }
+        truthName = reference + " at " + to_string(maxWidth) + " pixels";
+    }
+    int truthFaces = 0;
+    for (auto &faces: truth)
+        truthFaces += (int) faces.size();
+
+    cout << "Images: " << frames.size() << ", faces: " << truthFaces << " (" << truthName << ")" << endl;
+    cout << "The dnn backend gets the color images, the cascades the gray and equalized ones; in the applications "
+            "all of them get the gray frame" << endl;
+    cout << fixed << setprecision(2);
+    cout << setw(8) << "Backend" << setw(8) << "Width" << setw(12) << "ms/image" << setw(8) << "Faces"
+         << setw(10) << "Recall" << setw(12) << "Precision" << endl;
+    for (auto &detector: detectors) {
+        for (auto width: widths) {
+            double ms = 0;
+            int found = 0, matched = 0, correct = 0;
+            for (size_t i = 0; i < frames.size(); i++) {
+                Mat color, gray;
+                vector<Rect> faces;
+                double scale = prepareImage(frames[i], width, color, gray);
+                ms += detectFaces(*detector, detectorInput(*detector, color, gray), scale, runs, faces);
+                found += (int) faces.size();
+                matched += matchedFaces(truth[i], faces);
+                correct += matchedFaces(faces, truth[i]);
+            }
+            cout << setw(8) << detector->name << setw(8) << width << setw(12) << ms / frames.size()
+                 << setw(8) << found << setw(10) << (truthFaces > 0 ? (double) matched / truthFaces : 0)
+                 << setw(12) << (found > 0 ? (double) correct / found : 0) << endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,239 @@
+// FACE PIPELINE
+// Run several effects over the faces of the webcam with a single capture,
+// gray conversion, equalization and face detection for all of them
+
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "opencv2/objdetect/objdetect.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+#include "utils/FaceDetector.h"
+#include "utils/FaceTracker.h"
+#include "utils/FrameSource.h"
+#include "utils/SearchRegions.h"
+#include "utils/FaceEffects.h"
+
+using namespace cv;
+using namespace std;
+
+const char *keys =
+        {
+                "{help h usage ? | | print this message}"
+                "{faceCascade | ../resources/haarcascade_frontalface_alt.xml | Face cascade file, or the weights of the network with --face_detector=dnn}"
+                "{eyeCascade | ../resources/haarcascade_eye.xml | Eye cascade file}"
+                "{noseCascade | ../resources/haarcascade_mcs_nose.xml | Nose cascade file}"
+                "{mouthCascade | ../resources/haarcascade_mcs_mouth.xml | Mouth cascade file}"
+                "{leftEarCascade | ../resources/haarcascade_mcs_leftear.xml | Left ear cascade file}"
+                "{rightEarCascade | ../resources/haarcascade_mcs_rightear.xml | Right ear cascade file}"
+                "{sunglasses | ../resources/glasses.jpg | Sunglasses image}"
+                "{moustache | | Moustache image}"
+                "{nose | | Nose image}"
+                "{mask | ../resources/mask.jpg | Face mask image}"
+                "{effects | sunglasses,moustache,nose,mask,ears | Comma separated effects to apply, in order}"
+                "{detect_every | 5 | Run the detector every N frames and track between them, 1 detects in all frames}"
+                "{full_every | 5 | Scan the whole frame for faces every N detections and only around the known faces in between, 1 scans it always}"
+                FRAME_SOURCE_KEYS
+                FACE_DETECTOR_KEYS
+                "{compare | | Also run each effect alone, as its own application does, and compare the FPS}"
+        };
+
+/**
+ * Create an effect by its name, NULL if it is unknown or its files can not
+ * be loaded
+ */
+static Ptr<FaceEffect> createEffect(const string &name, const CommandLineParser &parser, int detectEvery) {
+    if (name == "sunglasses") {
+        Ptr<SunglassesEffect> effect = makePtr<SunglassesEffect>(parser.get<string>("eyeCascade"),
+                                                                 imread(parser.get<string>("sunglasses")));
+        if (effect->isLoaded())
+            return effect;
+    } else if (name == "moustache") {
+        Ptr<MoustacheEffect> effect = makePtr<MoustacheEffect>(parser.get<string>("mouthCascade"),
+                                                               imread(parser.get<string>("moustache")));
+        if (effect->isLoaded())
+            return effect;
+    } else if (name == "nose") {
+        Ptr<NoseEffect> effect = makePtr<NoseEffect>(parser.get<string>("noseCascade"),
+                                                     imread(parser.get<string>("nose")));
+        if (effect->isLoaded())
+            return effect;
+    } else if (name == "mask") {
+        Mat mask = imread(parser.get<string>("mask"));
+        if (!mask.empty())
+            return makePtr<MaskEffect>(mask);
+    } else if (name == "ears") {
+        Ptr<EarBoxesEffect> effect = makePtr<EarBoxesEffect>(parser.get<string>("leftEarCascade"),
+                                                             parser.get<string>("rightEarCascade"), detectEvery);
+        if (effect->isLoaded())
+            return effect;
+    }
+    return Ptr<FaceEffect>();
+}
+
+static double elapsedMs(int64 start) {
+    return (getTickCount() - start) * 1000.0 / getTickFrequency();
+}
+
+int main(int argc, char *argv[]) {
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 7. Face pipeline v1.0.0");
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+    string faceCascadeName = parser.get<string>("faceCascade");
+    string effectNames = parser.get<string>("effects");
+    int detectEvery = parser.get<int>("detect_every");
+    int fullEvery = parser.get<int>("full_every");
+    bool compare = parser.has("compare");
+    if (!parser.check()) {
+        parser.printErrors();
+        return 0;
+    }
+    // Haar, LBP or DNN face detector chosen in the command line
+    Ptr<FaceDetector> faceDetector = createFaceDetector(parser, faceCascadeName);
+
+    if (faceDetector.empty()) {
+        cerr << "Error loading face detector. Exiting!" << endl;
+        return -1;
+    }
+
+    vector<Ptr<FaceEffect> > effects;
+    stringstream names(effectNames);
+    string name;
+    while (getline(names, name, ',')) {
+        Ptr<FaceEffect> effect = createEffect(name, parser, detectEvery);
+        if (effect.empty()) {
+            cerr << "Error loading the files of the effect " << name << ". Skipping it!" << endl;
+            continue;
+        }
+        effects.push_back(effect);
+    }
+    if (effects.empty()) {
+        cerr << "No effects to apply. Exiting!" << endl;
+        return -1;
+    }
+
+    // Create the capture object, the webcam or the input to replay
+    FrameSource cap;
+
+    // If you cannot open the webcam, stop the execution!
+    if (!cap.open(parser)) {
+        cerr << "Error opening the input. Exiting!" << endl;
+        return -1;
+    }
+
+    //create GUI windows
+    namedWindow("Frame");
+
+    // Scaling factor to resize the input frames from the webcam
+    float scalingFactor = 0.75;
+
+    // Scan the whole frame every fullEvery detections and only around the known faces in between
+    SearchRegions searchRegions(faceDetector->detector(), fullEvery);
+
+    // Detect the faces every detectEvery frames and track them in between
+    FaceTracker faceTracker(searchRegions.detector(), detectEvery);
+
+    // With --compare, each effect also runs alone with its own tracker and its own instance of the
+    // effect, as its application; the effects keep state between frames and can not be shared
+    vector<Ptr<FaceEffect> > aloneEffects;
+    vector<Ptr<SearchRegions> > aloneRegions;
+    vector<Ptr<FaceTracker> > aloneTrackers;
+    for (size_t e = 0; compare && e < effects.size(); e++) {
+        aloneEffects.push_back(createEffect(effects[e]->name, parser, detectEvery));
+        aloneRegions.push_back(makePtr<SearchRegions>(faceDetector->detector(), fullEvery));
+        aloneTrackers.push_back(makePtr<FaceTracker>(aloneRegions.back()->detector(), detectEvery));
+    }
+
+    FrameContext context, alone;
+    Mat frame;
+    // Time of the shared steps, of each effect and of the effects alone
+    double prepareMs = 0, facesMs = 0, sharedMs = 0, aloneMs = 0;
+    vector<double> effectMs(effects.size(), 0);
+    int frames = 0;
+
+    // Iterate until the user presses the Esc key
+    while (true) {
+        // Capture the current frame
+        cap >> frame;
+        if (frame.empty())
+            break;
+
+        // Resize the frame
+        resize(frame, frame, Size(), scalingFactor, scalingFactor, INTER_AREA);
+
+        // Each effect alone repeats the gray conversion, equalization and face detection
+        for (size_t e = 0; compare && e < effects.size(); e++) {
+            frame.copyTo(alone.frame);
+            int64 start = getTickCount();
+            prepareFrame(alone);
+            alone.faces.clear();
+            if (aloneEffects[e]->needsFaces())
+                alone.faces = aloneTrackers[e]->update(alone.gray);
+            prepareRegions(alone);
+            aloneEffects[e]->apply(alone);
+            aloneMs += elapsedMs(start);
+        }
+
+        // Shared steps, once for all the effects
+        context.frame = frame;
+        int64 start = getTickCount();
+        prepareFrame(context);
+        prepareMs += elapsedMs(start);
+
+        int64 facesStart = getTickCount();
+        context.faces = faceTracker.update(context.gray);
+        prepareRegions(context);
+        facesMs += elapsedMs(facesStart);
+
+        for (size_t e = 0; e < effects.size(); e++) {
+            int64 effectStart = getTickCount();
+            effects[e]->apply(context);
+            effectMs[e] += elapsedMs(effectStart);
+        }
+        sharedMs += elapsedMs(start);
+        frames++;
+
+        // Show the current frame with the FPS of the pipeline
+        stringstream fps;
+        fps << fixed << setprecision(1) << frames * 1000.0 / sharedMs << " FPS";
+        putText(context.frame, fps.str(), Point(10, 25), FONT_HERSHEY_SIMPLEX, 0.7, Scalar(0, 255, 0), 2);
+        imshow("Frame", context.frame);
+
+        // Get the keyboard input and check if it's 'Esc'
+        // 27 -> ASCII value of 'Esc' key
+        auto ch = waitKey(1);
+        if (ch == 27) {
+            break;
+        }
+    }
+
+    if (frames > 0) {
+        cout << faceTracker.report() << endl;
+        cout << searchRegions.report() << endl;
+        cout << fixed << setprecision(2);
+        cout << "Frames: " << frames << endl;
+        cout << "Gray and equalization: " << prepareMs / frames << " ms/frame" << endl;
+        cout << "Faces: " << facesMs / frames << " ms/frame" << endl;
+        for (size_t e = 0; e < effects.size(); e++)
+            cout << "Effect " << effects[e]->name << ": " << effectMs[e] / frames << " ms/frame" << endl;
+        cout << "Shared pipeline: " << frames * 1000.0 / sharedMs << " FPS, " << sharedMs / frames
+             << " ms/frame" << endl;
+        if (compare)
+            cout << "Effects alone: " << frames * 1000.0 / aloneMs << " FPS, " << aloneMs / frames
+                 << " ms/frame, speedup " << aloneMs / sharedMs << endl;
+    }
+
+    cout << cap.report() << endl;
+
+    // Release the video capture object
+    cap.release();
+
+    // Close all windows
+    destroyAllWindows();
+
+    return 0;
+}
@@ -5,40 +5,70 @@
 #include "opencv2/objdetect/objdetect.hpp"
 #include <iostream>
 
-#define CV_HAAR_SCALE_IMAGE 2
+#include "utils/FaceDetector.h"
+#include "utils/FaceTracker.h"
+#include "utils/FrameSource.h"
+#include "utils/SearchRegions.h"
+#include "utils/OverlayCompositor.h"
 
 using namespace cv;
 using namespace std;
 
+const char *keys =
+        {
+                "{help h usage ? | | print this message}"
+                "{@faceCascade | | Face cascade file, or the weights of the network with --face_detector=dnn}"
+                "{@mask | | Face mask image}"
+                "{detect_every | 5 | Run the detector every N frames and track between them, 1 detects in all frames}"
+                "{full_every | 5 | Scan the whole frame for faces every N detections and only around the known faces in between, 1 scans it always}"
+                FRAME_SOURCE_KEYS
+                FACE_DETECTOR_KEYS
+        };
+
 int main(int argc, char *argv[]) {
     // 检测面部部分的一个分类器 xml
 //    string faceCascadeName = "../resources/haarcascade_frontalface_alt.xml";
-    string faceCascadeName = argv[1];
-    CascadeClassifier faceCascade;
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 7. Overlay face mask v1.0.0");
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+    string faceCascadeName = parser.get<string>("@faceCascade");
+    string maskName = parser.get<string>("@mask");
+    int detectEvery = parser.get<int>("detect_every");
+    int fullEvery = parser.get<int>("full_every");
+    if (!parser.check()) {
+        parser.printErrors();
+        return 0;
+    }
+    // Haar, LBP or DNN face detector chosen in the command line
+    Ptr<FaceDetector> faceDetector = createFaceDetector(parser, faceCascadeName);
 
-    if (!faceCascade.load(faceCascadeName)) {
-        cerr << "Error loading cascade file. Exiting!" << endl;
+    if (faceDetector.empty()) {
+        cerr << "Error loading face detector. Exiting!" << endl;
         return -1;
     }
     // 面具图像文件
-    Mat faceMask = imread(argv[2]);
+    Mat faceMask = imread(maskName);
     if (!faceMask.data) {
         cerr << "Error loading mask image. Exiting!" << endl;
     }
 
     // Current frame
     Mat frame, frameGray;
-    Mat frameROI, faceMaskSmall;
-    Mat grayMaskSmall, grayMaskSmallThresh, grayMaskSmallThreshInv;
-    Mat maskedFace, maskedFrame;
 
-    // Create the capture object
-    // 0 -> input arg that specifies it should take the input from the webcam
-    VideoCapture cap(0);
+    // Resized face mask and its alpha by size
+    OverlayCompositor compositor(faceMask, 245);
+
+    // Create the capture object, the webcam or the input to replay
+    FrameSource cap;
 
     // If you cannot open the webcam, stop the execution!
-    if (!cap.isOpened())
+    if (!cap.open(parser)) {
+        cerr << "Error opening the input. Exiting!" << endl;
         return -1;
+    }
 
     //create GUI windows
     namedWindow("Frame");
@@ -46,12 +76,20 @@ int main(int argc, char *argv[]) {
     // Scaling factor to resize the input frames from the webcam
     float scalingFactor = 0.75;
 
+    // Scan the whole frame every fullEvery detections and only around the known faces in between
+    SearchRegions searchRegions(faceDetector->detector(), fullEvery);
+
+    // Detect the faces every detectEvery frames and track them in between
+    FaceTracker faceTracker(searchRegions.detector(), detectEvery);
+
     vector<Rect> faces;
 
     // Iterate until the user presses the Esc key
     while (true) {
         // Capture the current frame
         cap >> frame;
+        if (frame.empty())
+            break;
 
         // Resize the frame
         resize(frame, frame, Size(), scalingFactor, scalingFactor, INTER_AREA);
@@ -64,8 +102,8 @@ int main(int argc, char *argv[]) {
         // 均衡直方图、补偿照明或饱和度等问题、保证图像具有健康的像素值范围
         equalizeHist(frameGray, frameGray);
 
-        // Detect faces
-        faceCascade.detectMultiScale(frameGray, faces, 1.1, 2, 0 | CV_HAAR_SCALE_IMAGE, Size(30, 30));
+        // Detect the faces or track them from the previous frame
+        faces = faceTracker.update(frameGray);
 
         // Draw green rectangle around the face
         for (auto &face: faces) {
@@ -75,36 +113,8 @@ int main(int argc, char *argv[]) {
             int y = face.y - int(0.0 * face.height);
             int w = int(1.2 * face.width);
             int h = int(1.2 * face.height);
-            // 检测数据是否超出图像范围、如果超出范围、frameROI = frame(Rect(x, y, w, h)); 调用时会引起程序报错
-            if (x > 0 && y > 0 && x + w < frame.cols && y + h < frame.rows) {
-                // Extract region of interest (ROI) covering your face
-                frameROI = frame(Rect(x, y, w, h));
-
-                // Resize the face mask image based on the dimensions of the above ROI
-                resize(faceMask, faceMaskSmall, Size(w, h));
-
-                // Convert the above image to grayscale
-                cvtColor(faceMaskSmall, grayMaskSmall, COLOR_BGR2GRAY);
-
-                // Threshold the above image to isolate the pixels associated only with the face mask
-                threshold(grayMaskSmall, grayMaskSmallThresh, 245, 255, THRESH_BINARY_INV);
-
-                // Create mask by inverting the above image (because we don't want the background to affect the overlay)
-                bitwise_not(grayMaskSmallThresh, grayMaskSmallThreshInv);
-
-                // Use bitwise "AND" operator to extract precise boundary of face mask
-                bitwise_and(faceMaskSmall, faceMaskSmall, maskedFace, grayMaskSmallThresh);
-
-                // Use bitwise "AND" operator to overlay face mask
-                bitwise_and(frameROI, frameROI, maskedFrame, grayMaskSmallThreshInv);
-
-                // Add the above masked images and place it in the original frame ROI to create the final image
-
-                add(maskedFace, maskedFrame, frame(Rect(x, y, w, h)));
-            } else {
-                // 打印超出范围的数据
-                cout << x << " " << y << " " << w << " " << h << endl;
-            }
+            // The compositor clips the mask to the frame when the face is near its border
+            compositor.overlay(frame, Rect(x, y, w, h));
         }
 
         // Show the current frame
@@ -112,12 +122,18 @@ int main(int argc, char *argv[]) {
 
         // Get the keyboard input and check if it's 'Esc'
         // 27 -> ASCII value of 'Esc' key
-        auto ch = waitKey(30);
+        auto ch = waitKey(cap.waitDelay(30));
         if (ch == 27) {
             break;
         }
     }
 
+    cout << faceTracker.report() << endl;
+    cout << searchRegions.report() << endl;
+    cout << compositor.report() << endl;
+
+    cout << cap.report() << endl;
+
     // Release the video capture object
     cap.release();
 
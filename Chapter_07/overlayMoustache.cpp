@@ -5,28 +5,62 @@
 #include "opencv2/objdetect/objdetect.hpp"
 #include <iostream>
 
+#include "utils/CascadeCache.h"
+#include "utils/FaceDetector.h"
+#include "utils/FaceTracker.h"
+#include "utils/FrameSource.h"
+#include "utils/SearchRegions.h"
+#include "utils/OverlayCompositor.h"
+
 #define CV_HAAR_SCALE_IMAGE 2
 
 using namespace cv;
 using namespace std;
 
+const char *keys =
+        {
+                "{help h usage ? | | print this message}"
+                "{@faceCascade | | Face cascade file, or the weights of the network with --face_detector=dnn}"
+                "{@mouthCascade | | Mouth cascade file}"
+                "{@mask | | Moustache image}"
+                "{detect_every | 5 | Run the detector every N frames and track between them, 1 detects in all frames}"
+                "{full_every | 5 | Scan the whole frame for faces every N detections and only around the known faces in between, 1 scans it always}"
+                FRAME_SOURCE_KEYS
+                FACE_DETECTOR_KEYS
+        };
+
 int main(int argc, char *argv[]) {
-    string faceCascadeName = argv[1];
-    string mouthCascadeName = argv[2];
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 7. Overlay moustache v1.0.0");
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+    string faceCascadeName = parser.get<string>("@faceCascade");
+    string mouthCascadeName = parser.get<string>("@mouthCascade");
+    string maskName = parser.get<string>("@mask");
+    int detectEvery = parser.get<int>("detect_every");
+    int fullEvery = parser.get<int>("full_every");
+    if (!parser.check()) {
+        parser.printErrors();
+        return 0;
+    }
 
-    CascadeClassifier faceCascade, mouthCascade;
+    // Haar, LBP or DNN face detector chosen in the command line
+    Ptr<FaceDetector> faceDetector = createFaceDetector(parser, faceCascadeName);
+    CascadeClassifier mouthCascade;
 
-    if (!faceCascade.load(faceCascadeName)) {
-        cerr << "Error loading face cascade file. Exiting!" << endl;
+    if (faceDetector.empty()) {
+        cerr << "Error loading face detector. Exiting!" << endl;
         return -1;
     }
 
-    if (!mouthCascade.load(mouthCascadeName)) {
+    if (!loadCascade(mouthCascade, mouthCascadeName)) {
         cerr << "Error loading mouth cascade file. Exiting!" << endl;
         return -1;
     }
 
-    Mat mouthMask = imread(argv[3]);
+    Mat mouthMask = imread(maskName);
 
     if (!mouthMask.data) {
         cerr << "Error loading moustache image. Exiting!" << endl;
@@ -35,17 +69,18 @@ int main(int argc, char *argv[]) {
 
     // Current frame
     Mat frame, frameGray;
-    Mat frameROI, mouthMaskSmall;
-    Mat grayMaskSmall, grayMaskSmallThresh, grayMaskSmallThreshInv;
-    Mat maskedMouth, maskedFrame;
 
-    // Create the capture object
-    // 0 -> input arg that specifies it should take the input from the webcam
-    VideoCapture cap(1);
+    // Resized moustache and its alpha by size
+    OverlayCompositor compositor(mouthMask, 245);
+
+    // Create the capture object, the webcam or the input to replay
+    FrameSource cap;
 
     // If you cannot open the webcam, stop the execution!
-    if (!cap.isOpened())
+    if (!cap.open(parser, 1)) {
+        cerr << "Error opening the input. Exiting!" << endl;
         return -1;
+    }
 
     //create GUI windows
     namedWindow("Frame");
@@ -53,12 +88,20 @@ int main(int argc, char *argv[]) {
     // Scaling factor to resize the input frames from the webcam
     float scalingFactor = 0.75;
 
+    // Scan the whole frame every fullEvery detections and only around the known faces in between
+    SearchRegions searchRegions(faceDetector->detector(), fullEvery);
+
+    // Detect the faces every detectEvery frames and track them in between
+    FaceTracker faceTracker(searchRegions.detector(), detectEvery);
+
     vector<Rect> faces;
 
     // Iterate until the user presses the Esc key
     while (true) {
         // Capture the current frame
         cap >> frame;
+        if (frame.empty())
+            break;
 
         // Resize the frame
         resize(frame, frame, Size(), scalingFactor, scalingFactor, INTER_AREA);
@@ -69,8 +112,8 @@ int main(int argc, char *argv[]) {
         // Equalize the histogram
         //equalizeHist(frameGray, frameGray);
 
-        // Detect faces
-        faceCascade.detectMultiScale(frameGray, faces, 1.1, 2, 0 | CV_HAAR_SCALE_IMAGE, Size(30, 30));
+        // Detect the faces or track them from the previous frame
+        faces = faceTracker.update(frameGray);
 
         vector<Point> centers;
 
@@ -93,14 +136,7 @@ int main(int argc, char *argv[]) {
                 int x = face.x + mouth.x - 0.2 * w;
                 int y = face.y + mouth.y + 0.65 * h;
 
-                frameROI = frame(Rect(x, y, w, h));
-                resize(mouthMask, mouthMaskSmall, Size(w, h));
-                cvtColor(mouthMaskSmall, grayMaskSmall, COLOR_BGR2GRAY);
-                threshold(grayMaskSmall, grayMaskSmallThresh, 245, 255, THRESH_BINARY_INV);
-                bitwise_not(grayMaskSmallThresh, grayMaskSmallThreshInv);
-                bitwise_and(mouthMaskSmall, mouthMaskSmall, maskedMouth, grayMaskSmallThresh);
-                bitwise_and(frameROI, frameROI, maskedFrame, grayMaskSmallThreshInv);
-                add(maskedMouth, maskedFrame, frame(Rect(x, y, w, h)));
+                compositor.overlay(frame, Rect(x, y, w, h));
             }
         }
 
@@ -109,13 +145,19 @@ int main(int argc, char *argv[]) {
 
         // Get the keyboard input and check if it's 'Esc'
         // 27 -> ASCII value of 'Esc' key
-        auto ch = waitKey(30);
+        auto ch = waitKey(cap.waitDelay(30));
         if (ch == 27) {
             break;
         }
 
     }
 
+    cout << faceTracker.report() << endl;
+    cout << searchRegions.report() << endl;
+    cout << compositor.report() << endl;
+
+    cout << cap.report() << endl;
+
     // Release the video capture object
     cap.release();
 
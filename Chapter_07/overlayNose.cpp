@@ -5,27 +5,61 @@
 #include "opencv2/objdetect/objdetect.hpp"
 #include <iostream>
 
+#include "utils/CascadeCache.h"
+#include "utils/FaceDetector.h"
+#include "utils/FaceTracker.h"
+#include "utils/FrameSource.h"
+#include "utils/SearchRegions.h"
+#include "utils/OverlayCompositor.h"
+
 #define CV_HAAR_SCALE_IMAGE 2
 
 using namespace cv;
 using namespace std;
 
+const char *keys =
+        {
+                "{help h usage ? | | print this message}"
+                "{@faceCascade | | Face cascade file, or the weights of the network with --face_detector=dnn}"
+                "{@noseCascade | | Nose cascade file}"
+                "{@mask | | Nose image}"
+                "{detect_every | 5 | Run the detector every N frames and track between them, 1 detects in all frames}"
+                "{full_every | 5 | Scan the whole frame for faces every N detections and only around the known faces in between, 1 scans it always}"
+                FRAME_SOURCE_KEYS
+                FACE_DETECTOR_KEYS
+        };
+
 int main(int argc, char *argv[]) {
-    string faceCascadeName = argv[1];
-    string noseCascadeName = argv[2];
-    CascadeClassifier faceCascade, noseCascade;
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 7. Overlay nose v1.0.0");
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+    string faceCascadeName = parser.get<string>("@faceCascade");
+    string noseCascadeName = parser.get<string>("@noseCascade");
+    string maskName = parser.get<string>("@mask");
+    int detectEvery = parser.get<int>("detect_every");
+    int fullEvery = parser.get<int>("full_every");
+    if (!parser.check()) {
+        parser.printErrors();
+        return 0;
+    }
+    // Haar, LBP or DNN face detector chosen in the command line
+    Ptr<FaceDetector> faceDetector = createFaceDetector(parser, faceCascadeName);
+    CascadeClassifier noseCascade;
 
-    if (!faceCascade.load(faceCascadeName)) {
-        cerr << "Error loading face cascade file. Exiting!" << endl;
+    if (faceDetector.empty()) {
+        cerr << "Error loading face detector. Exiting!" << endl;
         return -1;
     }
 
-    if (!noseCascade.load(noseCascadeName)) {
+    if (!loadCascade(noseCascade, noseCascadeName)) {
         cerr << "Error loading nose cascade file. Exiting!" << endl;
         return -1;
     }
 
-    Mat noseMask = imread(argv[3]);
+    Mat noseMask = imread(maskName);
 
     if (!noseMask.data) {
         cerr << "Error loading nose mask image. Exiting!" << endl;
@@ -34,19 +68,20 @@ int main(int argc, char *argv[]) {
 
     // Current frame
     Mat frame, frameGray;
-    Mat frameROI, noseMaskSmall;
-    Mat grayMaskSmall, grayMaskSmallThresh, grayMaskSmallThreshInv;
-    Mat maskedNose, maskedFrame;
 
     char ch;
 
-    // Create the capture object
-    // 0 -> input arg that specifies it should take the input from the webcam
-    VideoCapture cap(0);
+    // Resized nose and its alpha by size
+    OverlayCompositor compositor(noseMask, 250);
+
+    // Create the capture object, the webcam or the input to replay
+    FrameSource cap;
 
     // If you cannot open the webcam, stop the execution!
-    if (!cap.isOpened())
+    if (!cap.open(parser)) {
+        cerr << "Error opening the input. Exiting!" << endl;
         return -1;
+    }
 
     //create GUI windows
     namedWindow("Frame");
@@ -54,12 +89,20 @@ int main(int argc, char *argv[]) {
     // Scaling factor to resize the input frames from the webcam
     float scalingFactor = 0.75;
 
+    // Scan the whole frame every fullEvery detections and only around the known faces in between
+    SearchRegions searchRegions(faceDetector->detector(), fullEvery);
+
+    // Detect the faces every detectEvery frames and track them in between
+    FaceTracker faceTracker(searchRegions.detector(), detectEvery);
+
     vector<Rect> faces;
 
     // Iterate until the user presses the Esc key
     while (true) {
         // Capture the current frame
         cap >> frame;
+        if (frame.empty())
+            break;
 
         // Resize the frame
         resize(frame, frame, Size(), scalingFactor, scalingFactor, INTER_AREA);
@@ -70,8 +113,8 @@ int main(int argc, char *argv[]) {
         // Equalize the histogram
         equalizeHist(frameGray, frameGray);
 
-        // Detect faces
-        faceCascade.detectMultiScale(frameGray, faces, 1.1, 2, 0 | CV_HAAR_SCALE_IMAGE, Size(30, 30));
+        // Detect the faces or track them from the previous frame
+        faces = faceTracker.update(frameGray);
 
         // Draw green circles around the nose
         for (int i = 0; i < faces.size(); i++) {
@@ -87,27 +130,13 @@ int main(int argc, char *argv[]) {
                 int radius = int((noses[j].width + noses[j].height) * 0.25);
                 //circle( frame, center, radius, Scalar( 0, 255, 0 ), 4, 8, 0 );
 
-                for (int j = 0; j < noses.size(); j++) {
-                    Point center(faces[i].x + noses[j].x + int(noses[j].width * 0.5),
-                                 faces[i].y + noses[j].y + int(noses[j].height * 0.5));
-                    int radius = int((noses[j].width + noses[j].height) * 0.25);
-                    //circle( frame, center, radius, Scalar( 0, 255, 0 ), 4, 8, 0 );
-
-                    // Overlay moustache
-                    int w = 1.3 * noses[j].width;
-                    int h = 1.7 * noses[j].height;
-                    int x = faces[i].x + noses[j].x - 0.1 * w;
-                    int y = faces[i].y + noses[j].y - 0.3 * h;
-
-                    frameROI = frame(Rect(x, y, w, h));
-                    resize(noseMask, noseMaskSmall, Size(w, h));
-                    cvtColor(noseMaskSmall, grayMaskSmall, COLOR_BGR2GRAY);
-                    threshold(grayMaskSmall, grayMaskSmallThresh, 250, 255, THRESH_BINARY_INV);
-                    bitwise_not(grayMaskSmallThresh, grayMaskSmallThreshInv);
-                    bitwise_and(noseMaskSmall, noseMaskSmall, maskedNose, grayMaskSmallThresh);
-                    bitwise_and(frameROI, frameROI, maskedFrame, grayMaskSmallThreshInv);
-                    add(maskedNose, maskedFrame, frame(Rect(x, y, w, h)));
-                }
+                // Overlay moustache
+                int w = 1.3 * noses[j].width;
+                int h = 1.7 * noses[j].height;
+                int x = faces[i].x + noses[j].x - 0.1 * w;
+                int y = faces[i].y + noses[j].y - 0.3 * h;
+
+                compositor.overlay(frame, Rect(x, y, w, h));
             }
         }
 
@@ -116,12 +145,18 @@ int main(int argc, char *argv[]) {
 
         // Get the keyboard input and check if it's 'Esc'
         // 27 -> ASCII value of 'Esc' key
-        ch = waitKey(30);
+        ch = waitKey(cap.waitDelay(30));
         if (ch == 27) {
             break;
         }
     }
 
+    cout << faceTracker.report() << endl;
+    cout << searchRegions.report() << endl;
+    cout << compositor.report() << endl;
+
+    cout << cap.report() << endl;
+
     // Release the video capture object
     cap.release();
 
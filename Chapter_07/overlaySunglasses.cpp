@@ -4,29 +4,114 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include "opencv2/objdetect/objdetect.hpp"
 #include <iostream>
+#include <iomanip>
+
+#include "utils/CascadeCache.h"
+#include "utils/FaceDetector.h"
+#include "utils/FaceTracker.h"
+#include "utils/FrameSource.h"
+#include "utils/SearchRegions.h"
+#include "utils/OverlayCompositor.h"
+#include "utils/FaceParts.h"
 
 #define CV_HAAR_SCALE_IMAGE 2
 
 using namespace cv;
 using namespace std;
 
+const char *keys =
+        {
+                "{help h usage ? | | print this message}"
+                "{@faceCascade | | Face cascade file, or the weights of the network with --face_detector=dnn}"
+                "{@eyeCascade | | Eye cascade file}"
+                "{@mask | | Sunglasses image}"
+                "{detect_every | 5 | Run the detector every N frames and track between them, 1 detects in all frames}"
+                "{full_every | 5 | Scan the whole frame for faces every N detections and only around the known faces in between, 1 scans it always}"
+                FRAME_SOURCE_KEYS
+                FACE_DETECTOR_KEYS
+                "{benchmark | | Time the eye search with 1 to 10 copies of the first face found and exit}"
+        };
+
+// Faces wider than this are scaled down before searching the eyes
+const int maxFaceWidth = 200;
+
+/**
+ * Time the eye search of the whole face ROI, one face after the other, and
+ * the search in the eye band of the faces in parallel, with synthetic frames
+ * of 1 to 10 copies of a face side by side
+ */
+static void benchmarkEyeSearch(const Mat &frameGray, const Rect &face, CascadeClassifier &eyeCascade,
+                               PartDetector &eyeDetector) {
+    const int runs = 10;
+    Mat tile = frameGray(face);
+    vector<Rect> eyes;
+    vector<FaceRegion> regions;
+    vector<vector<Rect> > faceEyes;
+    cout << "Threads: " << getNumThreads() << ", face: " << face.width << "x" << face.height << endl;
+    cout << setw(6) << "Faces" << setw(14) << "Whole ms" << setw(14) << "Band ms" << setw(10) << "Speedup" << endl;
+    for (int n = 1; n <= 10; n++) {
+        Mat mosaic(tile.rows, tile.cols * n, CV_8UC1);
+        vector<Rect> faces;
+        for (int k = 0; k < n; k++) {
+            faces.push_back(Rect(k * tile.cols, 0, tile.cols, tile.rows));
+            tile.copyTo(mosaic(faces.back()));
+        }
+
+        int64 start = getTickCount();
+        for (int r = 0; r < runs; r++) {
+            for (size_t i = 0; i < faces.size(); i++)
+                eyeCascade.detectMultiScale(mosaic(faces[i]), eyes, 1.1, 2, 0 | CV_HAAR_SCALE_IMAGE, Size(30, 30));
+        }
+        double wholeMs = (getTickCount() - start) * 1000.0 / getTickFrequency() / runs;
+
+        start = getTickCount();
+        for (int r = 0; r < runs; r++) {
+            regions.resize(faces.size());
+            for (size_t i = 0; i < faces.size(); i++)
+                prepareFaceRegion(mosaic, faces[i], maxFaceWidth, regions[i]);
+            eyeDetector.detect(regions, eyeSearch, faceEyes);
+        }
+        double bandMs = (getTickCount() - start) * 1000.0 / getTickFrequency() / runs;
+
+        cout << fixed << setprecision(2) << setw(6) << n << setw(14) << wholeMs << setw(14) << bandMs
+             << setw(10) << wholeMs / bandMs << endl;
+    }
+}
+
 int main(int argc, char *argv[]) {
-    string faceCascadeName = argv[1];
-    string eyeCascadeName = argv[2];
-    CascadeClassifier faceCascade, eyeCascade;
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 7. Overlay sunglasses v1.0.0");
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+    string faceCascadeName = parser.get<string>("@faceCascade");
+    string eyeCascadeName = parser.get<string>("@eyeCascade");
+    string maskName = parser.get<string>("@mask");
+    int detectEvery = parser.get<int>("detect_every");
+    int fullEvery = parser.get<int>("full_every");
+    bool benchmark = parser.has("benchmark");
+    if (!parser.check()) {
+        parser.printErrors();
+        return 0;
+    }
+    // Haar, LBP or DNN face detector chosen in the command line
+    Ptr<FaceDetector> faceDetector = createFaceDetector(parser, faceCascadeName);
+    CascadeClassifier eyeCascade;
+    PartDetector eyeDetector;
 
-    if (!faceCascade.load(faceCascadeName)) {
-        cerr << "Error loading face cascade file. Exiting!" << endl;
+    if (faceDetector.empty()) {
+        cerr << "Error loading face detector. Exiting!" << endl;
         return -1;
     }
 
-    if (!eyeCascade.load(eyeCascadeName)) {
+    if (!loadCascade(eyeCascade, eyeCascadeName) || !eyeDetector.load(eyeCascadeName)) {
         cerr << "Error loading eye cascade file. Exiting!" << endl;
         return -1;
     }
 
     //Mat eyeMask = imread("../../images/glasses.jpg");
-    Mat eyeMask = imread(argv[3]);
+    Mat eyeMask = imread(maskName);
 
     if (!eyeMask.data) {
         cerr << "Error loading mask image. Exiting!" << endl;
@@ -34,19 +119,20 @@ int main(int argc, char *argv[]) {
 
     // Current frame
     Mat frame, frameGray;
-    Mat frameROI, eyeMaskSmall;
-    Mat grayMaskSmall, grayMaskSmallThresh, grayMaskSmallThreshInv;
-    Mat maskedEye, maskedFrame;
 
     char ch;
 
-    // Create the capture object
-    // 0 -> input arg that specifies it should take the input from the webcam
-    VideoCapture cap(0);
+    // Resized sunglasses and their alpha by size
+    OverlayCompositor compositor(eyeMask, 245);
+
+    // Create the capture object, the webcam or the input to replay
+    FrameSource cap;
 
     // If you cannot open the webcam, stop the execution!
-    if (!cap.isOpened())
+    if (!cap.open(parser)) {
+        cerr << "Error opening the input. Exiting!" << endl;
         return -1;
+    }
 
     //create GUI windows
     namedWindow("Frame");
@@ -54,12 +140,27 @@ int main(int argc, char *argv[]) {
     // Scaling factor to resize the input frames from the webcam
     float scalingFactor = 0.75;
 
+    // Scan the whole frame every fullEvery detections and only around the known faces in between
+    SearchRegions searchRegions(faceDetector->detector(), fullEvery);
+
+    // Detect the faces every detectEvery frames and track them in between
+    FaceTracker faceTracker(searchRegions.detector(), detectEvery);
+
     vector<Rect> faces;
+    vector<FaceRegion> regions;
+    vector<vector<Rect> > faceEyes;
+
+    // Time of the eye search of each frame by number of faces
+    const int maxReportedFaces = 10;
+    vector<double> eyeSearchMs(maxReportedFaces + 1, 0);
+    vector<int> eyeSearchFrames(maxReportedFaces + 1, 0);
 
     // Iterate until the user presses the Esc key
     while (true) {
         // Capture the current frame
         cap >> frame;
+        if (frame.empty())
+            break;
 
         // Resize the frame
         resize(frame, frame, Size(), scalingFactor, scalingFactor, INTER_AREA);
@@ -70,23 +171,31 @@ int main(int argc, char *argv[]) {
         // Equalize the histogram
         equalizeHist(frameGray, frameGray);
 
-        // Detect faces
-        faceCascade.detectMultiScale(frameGray, faces, 1.1, 2, 0 | CV_HAAR_SCALE_IMAGE, Size(30, 30));
+        // Detect the faces or track them from the previous frame
+        faces = faceTracker.update(frameGray);
 
-        vector<Point> centers;
-
-        // Draw green circles around the eyes
-        for (int i = 0; i < faces.size(); i++) {
-            Mat faceROI = frameGray(faces[i]);
-            vector<Rect> eyes;
+        if (benchmark && !faces.empty()) {
+            benchmarkEyeSearch(frameGray, faces[0], eyeCascade, eyeDetector);
+            break;
+        }
 
-            // In each face, detect eyes
-            eyeCascade.detectMultiScale(faceROI, eyes, 1.1, 2, 0 | CV_HAAR_SCALE_IMAGE, Size(30, 30));
+        vector<Point> centers;
 
-            // For each eye detected, compute the center
-            for (int j = 0; j < eyes.size(); j++) {
-                Point center(faces[i].x + eyes[j].x + int(eyes[j].width * 0.5),
-                             faces[i].y + eyes[j].y + int(eyes[j].height * 0.5));
+        // Search the eyes in the upper band of all the faces in parallel
+        int64 eyeSearchStart = getTickCount();
+        regions.resize(faces.size());
+        for (int i = 0; i < faces.size(); i++)
+            prepareFaceRegion(frameGray, faces[i], maxFaceWidth, regions[i]);
+        eyeDetector.detect(regions, eyeSearch, faceEyes);
+        int numFaces = min((int) faces.size(), maxReportedFaces);
+        eyeSearchMs[numFaces] += (getTickCount() - eyeSearchStart) * 1000.0 / getTickFrequency();
+        eyeSearchFrames[numFaces]++;
+
+        // For each eye detected, compute the center
+        for (int i = 0; i < faceEyes.size(); i++) {
+            for (int j = 0; j < faceEyes[i].size(); j++) {
+                Point center(faceEyes[i][j].x + int(faceEyes[i][j].width * 0.5),
+                             faceEyes[i][j].y + int(faceEyes[i][j].height * 0.5));
                 centers.push_back(center);
             }
         }
@@ -110,29 +219,8 @@ int main(int argc, char *argv[]) {
             int x = leftPoint.x - 0.25 * w;
             int y = leftPoint.y - 0.5 * h;
 
-            // Extract region of interest (ROI) covering both the eyes
-            frameROI = frame(Rect(x, y, w, h));
-
-            // Resize the sunglasses image based on the dimensions of the above ROI
-            resize(eyeMask, eyeMaskSmall, Size(w, h));
-
-            // Convert the above image to grayscale
-            cvtColor(eyeMaskSmall, grayMaskSmall, COLOR_BGR2GRAY);
-
-            // Threshold the above image to isolate the foreground object
-            threshold(grayMaskSmall, grayMaskSmallThresh, 245, 255, THRESH_BINARY_INV);
-
-            // Create mask by inverting the above image (because we don't want the background to affect the overlay)
-            bitwise_not(grayMaskSmallThresh, grayMaskSmallThreshInv);
-
-            // Use bitwise "AND" operator to extract precise boundary of sunglasses
-            bitwise_and(eyeMaskSmall, eyeMaskSmall, maskedEye, grayMaskSmallThresh);
-
-            // Use bitwise "AND" operator to overlay sunglasses
-            bitwise_and(frameROI, frameROI, maskedFrame, grayMaskSmallThreshInv);
-
-            // Add the above masked images and place it in the original frame ROI to create the final image
-            add(maskedEye, maskedFrame, frame(Rect(x, y, w, h)));
+            // Blend the sunglasses resized to the ROI covering both the eyes
+            compositor.overlay(frame, Rect(x, y, w, h));
         }
 
         // Show the current frame
@@ -140,13 +228,24 @@ int main(int argc, char *argv[]) {
 
         // Get the keyboard input and check if it's 'Esc'
         // 27 -> ASCII value of 'Esc' key
-        ch = waitKey(30);
+        ch = waitKey(cap.waitDelay(30));
         if (ch == 27) {
             break;
         }
 
     }
 
+    cout << faceTracker.report() << endl;
+    cout << searchRegions.report() << endl;
+    cout << compositor.report() << endl;
+    for (int n = 1; n <= maxReportedFaces; n++) {
+        if (eyeSearchFrames[n] > 0)
+            cout << "Eye search with " << n << (n == maxReportedFaces ? "+" : "") << " faces: "
+                 << eyeSearchMs[n] / eyeSearchFrames[n] << " ms/frame in " << eyeSearchFrames[n] << " frames" << endl;
+    }
+
+    cout << cap.report() << endl;
+
     // Release the video capture object
     cap.release();
 
@@ -0,0 +1,143 @@
+// SEARCH REGIONS BENCHMARK
+// Detect the faces of a replayed clip in every frame scanning the whole
+// frame, and again scanning only around the faces predicted from their
+// motion, and compare the pixels scanned, the FPS and the faces found
+
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "opencv2/objdetect/objdetect.hpp"
+#include <iostream>
+#include <iomanip>
+
+#include "utils/CascadeCache.h"
+#include "utils/FrameSource.h"
+#include "utils/SearchRegions.h"
+
+#define CV_HAAR_SCALE_IMAGE 2
+
+using namespace cv;
+using namespace std;
+
+const char *keys =
+        {
+                "{help h usage ? | | print this message}"
+                "{@faceCascade | ../resources/haarcascade_frontalface_alt.xml | Face cascade file}"
+                "{full_every | 5 | Scan the whole frame every N frames}"
+                "{margin | 0.5 | Fraction of the size of a face added to each side of its predicted box}"
+                FRAME_SOURCE_KEYS
+        };
+
+/**
+ * Results of a pass over the clip
+ */
+struct PassResult {
+    int frames;
+    double ms;
+    double pixels;
+    vector<vector<Rect> > faces;
+};
+
+/**
+ * Detect the faces of all the frames of the input
+ */
+static bool runPass(const CommandLineParser &parser, ObjectDetector detector, const SearchStats *stats,
+                    PassResult &result) {
+    FrameSource source;
+    if (!source.open(parser))
+        return false;
+    // Same scaling as the applications
+    float scalingFactor = 0.75;
+    Mat frame, frameGray;
+    result = PassResult();
+    while (source.read(frame)) {
+        int64 start = getTickCount();
+        resize(frame, frame, Size(), scalingFactor, scalingFactor, INTER_AREA);
+        cvtColor(frame, frameGray, COLOR_BGR2GRAY);
+        equalizeHist(frameGray, frameGray);
+        vector<Rect> faces;
+        detector(frameGray, faces);
+        result.ms += (getTickCount() - start) * 1000.0 / getTickFrequency();
+        if (!stats)
+            result.pixels += frameGray.total();
+        result.faces.push_back(faces);
+        result.frames++;
+    }
+    if (stats)
+        result.pixels = stats->pixels;
+    return result.frames > 0;
+}
+
+/**
+ * Faces of the full scan found by the search regions, with an IoU over 0.5
+ */
+static int matchedFaces(const vector<Rect> &full, const vector<Rect> &regions) {
+    int matched = 0;
+    for (auto &face: full) {
+        for (auto &other: regions) {
+            double iou = (double) (face & other).area() / (face | other).area();
+            if (iou > 0.5) {
+                matched++;
+                break;
+            }
+        }
+    }
+    return matched;
+}
+
+int main(int argc, char *argv[]) {
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 7. Search regions benchmark v1.0.0");
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+    string faceCascadeName = parser.get<string>("@faceCascade");
+    int fullEvery = parser.get<int>("full_every");
+    double margin = parser.get<double>("margin");
+    if (!parser.check()) {
+        parser.printErrors();
+        return 0;
+    }
+    if (parser.get<string>("input").empty()) {
+        cerr << "A clip to replay is required, use --input. Exiting!" << endl;
+        return -1;
+    }
+    CascadeClassifier faceCascade;
+
+    if (!loadCascade(faceCascade, faceCascadeName)) {
+        cerr << "Error loading face cascade file. Exiting!" << endl;
+        return -1;
+    }
+
+    ObjectDetector faceDetector = [&faceCascade](const Mat &gray, vector<Rect> &objects) {
+        faceCascade.detectMultiScale(gray, objects, 1.1, 2, 0 | CV_HAAR_SCALE_IMAGE, Size(30, 30));
+    };
+    SearchRegions searchRegions(faceDetector, fullEvery, margin);
+
+    PassResult full, regions;
+    if (!runPass(parser, faceDetector, NULL, full) ||
+        !runPass(parser, searchRegions.detector(), &searchRegions.getStats(), regions)) {
+        cerr << "Error reading the input. Exiting!" << endl;
+        return -1;
+    }
+
+    int fullFaces = 0, matched = 0;
+    for (size_t i = 0; i < full.faces.size() && i < regions.faces.size(); i++) {
+        fullFaces += (int) full.faces[i].size();
+        matched += matchedFaces(full.faces[i], regions.faces[i]);
+    }
+
+    cout << fixed << setprecision(2);
+    cout << "Frames: " << full.frames << endl;
+    cout << setw(16) << "" << setw(16) << "Pixels/frame" << setw(10) << "FPS" << setw(10) << "Faces" << endl;
+    cout << setw(16) << "Full frame" << setw(16) << full.pixels / full.frames << setw(10)
+         << full.frames * 1000.0 / full.ms << setw(10) << fullFaces << endl;
+    int regionFaces = 0;
+    for (auto &faces: regions.faces)
+        regionFaces += (int) faces.size();
+    cout << setw(16) << "Search regions" << setw(16) << regions.pixels / regions.frames << setw(10)
+         << regions.frames * 1000.0 / regions.ms << setw(10) << regionFaces << endl;
+    cout << searchRegions.report() << endl;
+    cout << "Faces of the full scan also found: " << matched << " of " << fullFaces << endl;
+    return 0;
+}
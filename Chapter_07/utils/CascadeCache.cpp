@@ -0,0 +1,205 @@
+#include "CascadeCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+#if !defined(_WIN32)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#endif
+
+#include <opencv2/core.hpp>
+
+using namespace cv;
+using namespace std;
+
+// Magic and version of the format, a different version is not read
+static const char cacheMagic[8] = {'C', 'V', 'C', 'A', 'S', 'C', 'A', 'D'};
+static const unsigned int cacheVersion = 1;
+
+/**
+ * Header of the cache, the JSON of the cascade follows it
+ */
+struct CacheHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int payloadSize;
+    // Size and modification time of the XML the cache was made from
+    long long sourceSize;
+    long long sourceTime;
+};
+
+/**
+ * Size and modification time of a file
+ */
+static bool fileStamp(const string &file, long long &size, long long &time) {
+    struct stat info;
+    if (stat(file.c_str(), &info) != 0)
+        return false;
+    size = (long long) info.st_size;
+    time = (long long) info.st_mtime;
+    return true;
+}
+
+/**
+ * Read only view of a whole file, mapped in memory where it is possible
+ */
+class MappedFile {
+public:
+    MappedFile(const string &file) : data(NULL), size(0) {
+#if !defined(_WIN32)
+        int fd = ::open(file.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void *mapped = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                data = (const char *) mapped;
+                size = (size_t) info.st_size;
+            }
+        }
+        ::close(fd);
+#else
+        ifstream in(file.c_str(), ios::binary);
+        buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        data = buffer.empty() ? NULL : &buffer[0];
+        size = buffer.size();
+#endif
+    }
+
+    ~MappedFile() {
+#if !defined(_WIN32)
+        if (data)
+            munmap((void *) data, size);
+#endif
+    }
+
+    const char *data;
+    size_t size;
+
+private:
+#if defined(_WIN32)
+    string buffer;
+#endif
+};
+
+string cascadeCacheFile(const string &xmlFile) {
+    return xmlFile + ".cache";
+}
+
+/**
+ * Copy a node and all its children to the output storage
+ */
+static void copyNode(const FileNode &node, FileStorage &out, const string &name) {
+    if (!name.empty())
+        out << name;
+    switch (node.type() & FileNode::TYPE_MASK) {
+        case FileNode::MAP:
+            out << "{";
+            for (auto it = node.begin(); it != node.end(); ++it)
+                copyNode(*it, out, (*it).name());
+            out << "}";
+            break;
+        case FileNode::SEQ:
+            out << "[";
+            for (auto it = node.begin(); it != node.end(); ++it)
+                copyNode(*it, out, "");
+            out << "]";
+            break;
+        case FileNode::INT:
+            out << (int) node;
+            break;
+        case FileNode::REAL:
+            out << (double) node;
+            break;
+        default:
+            out << (string) node;
+    }
+}
+
+bool writeCascadeCache(const string &xmlFile, const string &cacheFile) {
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    if (!fileStamp(xmlFile, header.sourceSize, header.sourceTime))
+        return false;
+
+    // The old format is converted once here instead of in each load
+    string newXml = xmlFile;
+    FileStorage in(xmlFile, FileStorage::READ);
+    if (!in.isOpened())
+        return false;
+    bool oldFormat = in.getFirstTopLevelNode()["stageType"].empty();
+    if (oldFormat) {
+        in.release();
+        newXml = cacheFile + ".tmp.xml";
+        if (!CascadeClassifier::convert(xmlFile, newXml))
+            return false;
+        in.open(newXml, FileStorage::READ);
+    }
+    FileNode root = in.getFirstTopLevelNode();
+
+    // Check that the converted cascade can be read
+    CascadeClassifier check;
+    bool valid = check.read(root);
+    string payload;
+    if (valid) {
+        FileStorage out(".json", FileStorage::WRITE | FileStorage::MEMORY | FileStorage::FORMAT_JSON);
+        copyNode(root, out, "cascade");
+        payload = out.releaseAndGetString();
+    }
+    in.release();
+    if (oldFormat)
+        remove(newXml.c_str());
+    if (!valid)
+        return false;
+
+    memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = cacheVersion;
+    header.payloadSize = (unsigned int) payload.size();
+    // Written to a temporary file and renamed, a process loading it never sees half a cache
+    string tmpFile = cacheFile + ".tmp";
+    {
+        ofstream out(tmpFile.c_str(), ios::binary);
+        out.write((const char *) &header, sizeof(header));
+        out.write(payload.data(), payload.size());
+        if (!out)
+            return false;
+    }
+    return rename(tmpFile.c_str(), cacheFile.c_str()) == 0;
+}
+
+/**
+ * Load the cascade from the cache if it exists, has this version and was
+ * made from the current XML
+ */
+static bool loadFromCache(CascadeClassifier &cascade, const string &xmlFile, const string &cacheFile) {
+    MappedFile file(cacheFile);
+    if (!file.data || file.size < sizeof(CacheHeader))
+        return false;
+    CacheHeader header;
+    memcpy(&header, file.data, sizeof(header));
+    if (memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != cacheVersion ||
+        file.size < sizeof(header) + header.payloadSize)
+        return false;
+    // Without the XML the cache is used as it is
+    long long size, time;
+    if (fileStamp(xmlFile, size, time) && (size != header.sourceSize || time != header.sourceTime))
+        return false;
+
+    FileStorage fs(string(file.data + sizeof(header), header.payloadSize),
+                   FileStorage::READ | FileStorage::MEMORY | FileStorage::FORMAT_JSON);
+    return fs.isOpened() && cascade.read(fs.getFirstTopLevelNode());
+}
+
+bool loadCascade(CascadeClassifier &cascade, const string &xmlFile, const string &cacheFile, bool *fromCache) {
+    bool cached = loadFromCache(cascade, xmlFile, cacheFile.empty() ? cascadeCacheFile(xmlFile) : cacheFile);
+    if (fromCache)
+        *fromCache = cached;
+    return cached || cascade.load(xmlFile);
+}
@@ -0,0 +1,45 @@
+/**
+ * Cascade Cache
+ *
+ * CascadeClassifier::load parses the whole XML of the cascade in each start,
+ * and the cascades of resources are in the old format, converted to the new
+ * one after parsing them. The cache stores the converted cascade in a compact
+ * file: a binary header with the size and modification time of its XML,
+ * followed by the cascade in compact JSON without comments. The loader maps
+ * the file in memory and builds the classifier from it, and loads the XML as
+ * before when there is no cache or it is not the one of the XML.
+ *
+ */
+
+#ifndef CASCADE_CACHE_h
+#define CASCADE_CACHE_h
+
+#include <string>
+
+#include <opencv2/objdetect.hpp>
+
+/**
+ * Cache file of a cascade, next to its XML
+ */
+std::string cascadeCacheFile(const std::string &xmlFile);
+
+/**
+ * Write the cache of a cascade
+ * @param xmlFile cascade in the old or new XML format
+ * @param cacheFile output cache file
+ * @return false if the cascade can not be read or the cache can not be written
+ */
+bool writeCascadeCache(const std::string &xmlFile, const std::string &cacheFile);
+
+/**
+ * Load a cascade from its cache if it is valid, else from its XML
+ * @param cascade output classifier
+ * @param xmlFile cascade XML
+ * @param cacheFile cache of the cascade, empty uses cascadeCacheFile(xmlFile)
+ * @param fromCache output, whether it was loaded from the cache
+ * @return false if the cascade can not be loaded
+ */
+bool loadCascade(cv::CascadeClassifier &cascade, const std::string &xmlFile, const std::string &cacheFile = "",
+                 bool *fromCache = NULL);
+
+#endif
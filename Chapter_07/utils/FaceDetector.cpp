@@ -0,0 +1,88 @@
+#include "FaceDetector.h"
+
+#include <iostream>
+
+#include <opencv2/imgproc.hpp>
+
+#include "CascadeCache.h"
+
+#define CV_HAAR_SCALE_IMAGE 2
+
+using namespace cv;
+using namespace std;
+
+// Input of the network and mean of its training images
+const Size dnnInputSize(300, 300);
+const Scalar dnnMean(104.0, 177.0, 123.0);
+
+ObjectDetector FaceDetector::detector() {
+    return [this](const Mat &gray, vector<Rect> &objects) {
+        detect(gray, objects);
+    };
+}
+
+CascadeFaceDetector::CascadeFaceDetector(const string &name, const string &cascadeFile) : FaceDetector(name) {
+    loaded = loadCascade(cascade, cascadeFile);
+}
+
+void CascadeFaceDetector::detect(const Mat &gray, vector<Rect> &faces) {
+    cascade.detectMultiScale(gray, faces, 1.1, 2, 0 | CV_HAAR_SCALE_IMAGE, Size(30, 30));
+}
+
+DnnFaceDetector::DnnFaceDetector(const string &modelFile, const string &configFile, double minConfidence)
+        : FaceDetector("dnn"), minConfidence(minConfidence) {
+    if (modelFile.empty() || configFile.empty())
+        return;
+    // A missing or corrupt file throws, the detector is left without a network
+    try {
+        net = dnn::readNetFromCaffe(configFile, modelFile);
+    } catch (const cv::Exception &e) {
+        cerr << "Error reading the face network: " << e.what() << endl;
+        net = dnn::Net();
+    }
+}
+
+void DnnFaceDetector::detect(const Mat &frame, vector<Rect> &faces) {
+    faces.clear();
+    if (frame.channels() == 1)
+        cvtColor(frame, bgr, COLOR_GRAY2BGR);
+    else
+        bgr = frame;
+    Mat inputBlob = dnn::blobFromImage(bgr, 1.0, dnnInputSize, dnnMean, false, false);
+    net.setInput(inputBlob, "data");
+    Mat detection = net.forward("detection_out");
+
+    // One row per face: image, class, confidence and the corners relative to the frame
+    Mat detectionMat(detection.size[2], detection.size[3], CV_32F, detection.ptr<float>());
+    Rect frameRect(0, 0, frame.cols, frame.rows);
+    for (int i = 0; i < detectionMat.rows; i++) {
+        if (detectionMat.at<float>(i, 2) < minConfidence)
+            continue;
+        int x1 = cvRound(detectionMat.at<float>(i, 3) * frame.cols);
+        int y1 = cvRound(detectionMat.at<float>(i, 4) * frame.rows);
+        int x2 = cvRound(detectionMat.at<float>(i, 5) * frame.cols);
+        int y2 = cvRound(detectionMat.at<float>(i, 6) * frame.rows);
+        Rect face = Rect(x1, y1, x2 - x1, y2 - y1) & frameRect;
+        if (face.area() > 0)
+            faces.push_back(face);
+    }
+}
+
+Ptr<FaceDetector> createFaceDetector(const string &backend, const string &model, const string &config,
+                                     double minConfidence) {
+    if (backend == "haar" || backend == "lbp") {
+        Ptr<CascadeFaceDetector> detector = makePtr<CascadeFaceDetector>(backend, model);
+        if (detector->isLoaded())
+            return detector;
+    } else if (backend == "dnn") {
+        Ptr<DnnFaceDetector> detector = makePtr<DnnFaceDetector>(model, config, minConfidence);
+        if (detector->isLoaded())
+            return detector;
+    }
+    return Ptr<FaceDetector>();
+}
+
+Ptr<FaceDetector> createFaceDetector(const CommandLineParser &parser, const string &model) {
+    return createFaceDetector(parser.get<string>("face_detector"), model, parser.get<string>("face_config"),
+                              parser.get<double>("min_confidence"));
+}
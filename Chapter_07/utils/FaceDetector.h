@@ -0,0 +1,113 @@
+/**
+ * Face Detector
+ *
+ * Common interface of the face detectors, so the applications choose the
+ * backend at runtime: "haar" and "lbp" run a cascade (the same
+ * CascadeClassifier reads both kinds of cascade), and "dnn" runs the
+ * ResNet-10 SSD of Chapter 12. All of them receive the gray and equalized
+ * frame used by the trackers and the search regions; the network gets it
+ * replicated in its three channels, or the color frame when it is given
+ * one, as the network was trained with color images.
+ *
+ */
+
+#ifndef FACE_DETECTOR_h
+#define FACE_DETECTOR_h
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+#include <opencv2/objdetect.hpp>
+
+#include "FaceTracker.h"
+
+/**
+ * Keys of the command line to choose the face detector, model is given by
+ * each application
+ */
+#define FACE_DETECTOR_KEYS \
+    "{face_detector | haar | Face detector backend: haar, lbp or dnn}" \
+    "{face_config | | Network configuration of the dnn face detector (deploy.prototxt)}" \
+    "{min_confidence | 0.5 | Minimum confidence of the faces of the dnn face detector}"
+
+class FaceDetector {
+public:
+    FaceDetector(const std::string &name) : name(name) {}
+
+    virtual ~FaceDetector() {}
+
+    /**
+     * Faces of a gray and equalized frame
+     */
+    virtual void detect(const cv::Mat &gray, std::vector<cv::Rect> &faces) = 0;
+
+    /**
+     * The detector as an ObjectDetector, for the FaceTracker and the SearchRegions
+     */
+    ObjectDetector detector();
+
+    std::string name;
+};
+
+/**
+ * Haar or LBP cascade
+ */
+class CascadeFaceDetector : public FaceDetector {
+public:
+    CascadeFaceDetector(const std::string &name, const std::string &cascadeFile);
+
+    bool isLoaded() const { return loaded; }
+
+    void detect(const cv::Mat &gray, std::vector<cv::Rect> &faces);
+
+private:
+    bool loaded;
+    cv::CascadeClassifier cascade;
+};
+
+/**
+ * ResNet-10 SSD face detector of Caffe
+ */
+class DnnFaceDetector : public FaceDetector {
+public:
+    /**
+     * Constructor
+     *
+     * @param modelFile weights, res10_300x300_ssd_iter_140000.caffemodel
+     * @param configFile network configuration, deploy.prototxt
+     * @param minConfidence faces with a lower confidence are discarded
+     */
+    DnnFaceDetector(const std::string &modelFile, const std::string &configFile, double minConfidence = 0.5);
+
+    bool isLoaded() const { return !net.empty(); }
+
+    /**
+     * Faces of a gray frame, or of a color frame
+     */
+    void detect(const cv::Mat &frame, std::vector<cv::Rect> &faces);
+
+private:
+    cv::dnn::Net net;
+    double minConfidence;
+    cv::Mat bgr;
+};
+
+/**
+ * Create a face detector by the name of its backend
+ * @param backend haar, lbp or dnn
+ * @param model cascade file, or the weights of the network
+ * @param config network configuration, only for dnn
+ * @param minConfidence minimum confidence of the faces, only for dnn
+ * @return NULL if the backend is unknown or its files can not be loaded
+ */
+cv::Ptr<FaceDetector> createFaceDetector(const std::string &backend, const std::string &model,
+                                         const std::string &config = "", double minConfidence = 0.5);
+
+/**
+ * Create the face detector chosen with the FACE_DETECTOR_KEYS of the command line
+ */
+cv::Ptr<FaceDetector> createFaceDetector(const cv::CommandLineParser &parser, const std::string &model);
+
+#endif
@@ -0,0 +1,125 @@
+#include "FaceEffects.h"
+
+#include <opencv2/imgproc.hpp>
+
+using namespace cv;
+using namespace std;
+
+// Faces wider than this are scaled down before searching their parts
+static const int maxFaceWidth = 200;
+
+void prepareFrame(FrameContext &context) {
+    cvtColor(context.frame, context.gray, COLOR_BGR2GRAY);
+    equalizeHist(context.gray, context.gray);
+}
+
+void prepareRegions(FrameContext &context) {
+    context.regions.resize(context.faces.size());
+    for (size_t i = 0; i < context.faces.size(); i++)
+        prepareFaceRegion(context.gray, context.faces[i], maxFaceWidth, context.regions[i]);
+}
+
+SunglassesEffect::SunglassesEffect(const string &eyeCascade, const Mat &glasses)
+        : FaceEffect("sunglasses"), compositor(glasses, 245) {
+    loaded = !glasses.empty() && eyeDetector.load(eyeCascade);
+}
+
+void SunglassesEffect::apply(FrameContext &context) {
+    eyeDetector.detect(context.regions, eyeSearch, eyes);
+    for (auto &faceEyes: eyes) {
+        // Only the faces with both eyes
+        if (faceEyes.size() != 2)
+            continue;
+        Point leftPoint(faceEyes[0].x + int(faceEyes[0].width * 0.5), faceEyes[0].y + int(faceEyes[0].height * 0.5));
+        Point rightPoint(faceEyes[1].x + int(faceEyes[1].width * 0.5), faceEyes[1].y + int(faceEyes[1].height * 0.5));
+        if (rightPoint.x < leftPoint.x)
+            swap(leftPoint, rightPoint);
+
+        // Same fit as overlaySunglasses
+        int w = 2.3 * (rightPoint.x - leftPoint.x);
+        int h = int(0.4 * w);
+        int x = leftPoint.x - 0.25 * w;
+        int y = leftPoint.y - 0.5 * h;
+        compositor.overlay(context.frame, Rect(x, y, w, h));
+    }
+}
+
+MoustacheEffect::MoustacheEffect(const string &mouthCascade, const Mat &moustache)
+        : FaceEffect("moustache"), compositor(moustache, 245) {
+    loaded = !moustache.empty() && mouthDetector.load(mouthCascade);
+}
+
+void MoustacheEffect::apply(FrameContext &context) {
+    mouthDetector.detect(context.regions, mouthSearch, mouths);
+    for (auto &faceMouths: mouths) {
+        for (auto &mouth: faceMouths) {
+            // Same fit as overlayMoustache
+            int w = 1.8 * mouth.width;
+            int h = mouth.height;
+            int x = mouth.x - 0.2 * w;
+            int y = mouth.y + 0.65 * h;
+            compositor.overlay(context.frame, Rect(x, y, w, h));
+        }
+    }
+}
+
+NoseEffect::NoseEffect(const string &noseCascade, const Mat &nose)
+        : FaceEffect("nose"), compositor(nose, 250) {
+    loaded = !nose.empty() && noseDetector.load(noseCascade);
+}
+
+void NoseEffect::apply(FrameContext &context) {
+    noseDetector.detect(context.regions, noseSearch, noses);
+    for (auto &faceNoses: noses) {
+        for (auto &nose: faceNoses) {
+            // Same fit as overlayNose
+            int w = 1.3 * nose.width;
+            int h = 1.7 * nose.height;
+            int x = nose.x - 0.1 * w;
+            int y = nose.y - 0.3 * h;
+            compositor.overlay(context.frame, Rect(x, y, w, h));
+        }
+    }
+}
+
+MaskEffect::MaskEffect(const Mat &mask) : FaceEffect("mask"), compositor(mask, 245) {}
+
+void MaskEffect::apply(FrameContext &context) {
+    for (auto &face: context.faces) {
+        // Same fit as overlayFacemask
+        int x = face.x - int(0.2 * face.width);
+        int y = face.y;
+        int w = int(1.2 * face.width);
+        int h = int(1.2 * face.height);
+        compositor.overlay(context.frame, Rect(x, y, w, h));
+    }
+}
+
+EarBoxesEffect::EarBoxesEffect(const string &leftEarCascadeName, const string &rightEarCascadeName,
+                               int detectEvery)
+        : FaceEffect("ears"), earDetector(1.1, 2, Size(30, 30)), frameIndex(0), detectedFrame(-1),
+          leftEarTracker([this](const Mat &gray, vector<Rect> &objects) {
+              detectEars(gray);
+              objects = ears[0];
+          }, detectEvery),
+          rightEarTracker([this](const Mat &gray, vector<Rect> &objects) {
+              detectEars(gray);
+              objects = ears[1];
+          }, detectEvery) {
+    loaded = earDetector.add(leftEarCascadeName) && earDetector.add(rightEarCascadeName);
+}
+
+void EarBoxesEffect::detectEars(const Mat &gray) {
+    if (detectedFrame != frameIndex) {
+        earDetector.detect(gray, ears);
+        detectedFrame = frameIndex;
+    }
+}
+
+void EarBoxesEffect::apply(FrameContext &context) {
+    for (auto &leftEar: leftEarTracker.update(context.gray))
+        rectangle(context.frame, leftEar, Scalar(0, 255, 0), 4);
+    for (auto &rightEar: rightEarTracker.update(context.gray))
+        rectangle(context.frame, rightEar, Scalar(0, 255, 0), 4);
+    frameIndex++;
+}
@@ -0,0 +1,162 @@
+/**
+ * Face Effects
+ *
+ * Effects of the face pipeline. The frame is converted to gray, equalized and
+ * the faces are detected once, then each effect receives the same
+ * FrameContext: the gray frame to run its own cascades, the faces and their
+ * ROIs, already scaled, to search the parts, and the frame where it draws.
+ *
+ */
+
+#ifndef FACE_EFFECTS_h
+#define FACE_EFFECTS_h
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/objdetect.hpp>
+
+#include "FaceParts.h"
+#include "FaceTracker.h"
+#include "MultiCascadeDetector.h"
+#include "OverlayCompositor.h"
+
+/**
+ * Results of the shared steps of a frame
+ */
+struct FrameContext {
+    // Frame where the effects draw
+    cv::Mat frame;
+    // Gray and equalized frame
+    cv::Mat gray;
+    std::vector<cv::Rect> faces;
+    // ROIs of the faces shared by the part cascades
+    std::vector<FaceRegion> regions;
+};
+
+/**
+ * Convert the frame to gray and equalize it
+ */
+void prepareFrame(FrameContext &context);
+
+/**
+ * Extract the ROIs of the faces of the context
+ */
+void prepareRegions(FrameContext &context);
+
+/**
+ * Stage of the pipeline
+ */
+class FaceEffect {
+public:
+    FaceEffect(const std::string &name) : name(name) {}
+
+    virtual ~FaceEffect() {}
+
+    /**
+     * Whether the effect uses the faces, the ones that do not are not
+     * charged with the face detection when they run alone
+     */
+    virtual bool needsFaces() const { return true; }
+
+    virtual void apply(FrameContext &context) = 0;
+
+    std::string name;
+};
+
+/**
+ * Sunglasses over the faces with both eyes found
+ */
+class SunglassesEffect : public FaceEffect {
+public:
+    SunglassesEffect(const std::string &eyeCascade, const cv::Mat &glasses);
+
+    bool isLoaded() const { return loaded; }
+
+    void apply(FrameContext &context);
+
+private:
+    bool loaded;
+    PartDetector eyeDetector;
+    OverlayCompositor compositor;
+    std::vector<std::vector<cv::Rect> > eyes;
+};
+
+/**
+ * Moustache over each mouth
+ */
+class MoustacheEffect : public FaceEffect {
+public:
+    MoustacheEffect(const std::string &mouthCascade, const cv::Mat &moustache);
+
+    bool isLoaded() const { return loaded; }
+
+    void apply(FrameContext &context);
+
+private:
+    bool loaded;
+    PartDetector mouthDetector;
+    OverlayCompositor compositor;
+    std::vector<std::vector<cv::Rect> > mouths;
+};
+
+/**
+ * Funny nose over each nose
+ */
+class NoseEffect : public FaceEffect {
+public:
+    NoseEffect(const std::string &noseCascade, const cv::Mat &nose);
+
+    bool isLoaded() const { return loaded; }
+
+    void apply(FrameContext &context);
+
+private:
+    bool loaded;
+    PartDetector noseDetector;
+    OverlayCompositor compositor;
+    std::vector<std::vector<cv::Rect> > noses;
+};
+
+/**
+ * Mask over each face
+ */
+class MaskEffect : public FaceEffect {
+public:
+    MaskEffect(const cv::Mat &mask);
+
+    void apply(FrameContext &context);
+
+private:
+    OverlayCompositor compositor;
+};
+
+/**
+ * Boxes around the ears, searched in the whole gray frame
+ */
+class EarBoxesEffect : public FaceEffect {
+public:
+    EarBoxesEffect(const std::string &leftEarCascade, const std::string &rightEarCascade, int detectEvery);
+
+    bool isLoaded() const { return loaded; }
+
+    bool needsFaces() const { return false; }
+
+    void apply(FrameContext &context);
+
+private:
+    /**
+     * Detect both ears once per frame, the first tracker that needs them runs it
+     */
+    void detectEars(const cv::Mat &gray);
+
+    bool loaded;
+    // Both ears with a single pyramid
+    MultiCascadeDetector earDetector;
+    std::vector<std::vector<cv::Rect> > ears;
+    long frameIndex, detectedFrame;
+    FaceTracker leftEarTracker, rightEarTracker;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include "FaceParts.h"
+
+#include <algorithm>
+
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "CascadeCache.h"
+
+using namespace cv;
+using namespace std;
+
+#define CV_HAAR_SCALE_IMAGE 2
+
+// Eyes in the upper half, nose in the center and mouth in the lower third
+const PartSearch eyeSearch = {0.15f, 0.6f, 0.12f, 0.45f, 2};
+const PartSearch noseSearch = {0.3f, 0.85f, 0.15f, 0.5f, 2};
+const PartSearch mouthSearch = {0.55f, 1.0f, 0.2f, 0.7f, 5};
+
+void prepareFaceRegion(const Mat &frameGray, const Rect &face, int maxWidth, FaceRegion &region) {
+    region.face = face;
+    if (face.width > maxWidth) {
+        region.scale = (double) maxWidth / face.width;
+        resize(frameGray(face), region.gray, Size(maxWidth, cvRound(face.height * region.scale)), 0, 0, INTER_AREA);
+    } else {
+        region.scale = 1;
+        region.gray = frameGray(face);
+    }
+}
+
+void detectPart(CascadeClassifier &cascade, const FaceRegion &region, const PartSearch &search,
+                vector<Rect> &parts) {
+    parts.clear();
+    int top = cvRound(region.gray.rows * search.top);
+    int bottom = cvRound(region.gray.rows * search.bottom);
+    if (bottom <= top)
+        return;
+    Mat band = region.gray.rowRange(top, bottom);
+    // Sizes relative to the face, never under the window of the cascade
+    Size window = cascade.getOriginalWindowSize();
+    int minSize = max(cvRound(region.gray.cols * search.minSize), max(window.width, window.height));
+    int maxSize = max(minSize, cvRound(region.gray.cols * search.maxSize));
+    if (band.rows < minSize || band.cols < minSize)
+        return;
+    cascade.detectMultiScale(band, parts, 1.1, search.minNeighbors, 0 | CV_HAAR_SCALE_IMAGE,
+                             Size(minSize, minSize), Size(maxSize, maxSize));
+    // Back to frame coordinates
+    for (auto &part: parts) {
+        part = Rect(region.face.x + cvRound(part.x / region.scale),
+                    region.face.y + cvRound((part.y + top) / region.scale),
+                    cvRound(part.width / region.scale), cvRound(part.height / region.scale));
+    }
+}
+
+bool PartDetector::load(const string &file) {
+    // Each copy is loaded, copies of a CascadeClassifier share their state
+    cascades.resize(max(1, getNumThreads()));
+    for (auto &cascade: cascades) {
+        if (!loadCascade(cascade, file))
+            return false;
+    }
+    return true;
+}
+
+void PartDetector::detect(const vector<FaceRegion> &regions, const PartSearch &search,
+                          vector<vector<Rect> > &parts) {
+    parts.resize(regions.size());
+    int stripes = (int) min(cascades.size(), regions.size());
+    if (stripes <= 1) {
+        for (size_t i = 0; i < regions.size(); i++)
+            detectPart(cascades[0], regions[i], search, parts[i]);
+        return;
+    }
+    // Each stripe uses its own cascade and the faces stripe, stripe + stripes...
+    parallel_for_(Range(0, stripes), [&](const Range &range) {
+        for (int s = range.start; s < range.end; s++) {
+            for (size_t i = s; i < regions.size(); i += stripes)
+                detectPart(cascades[s], regions[i], search, parts[i]);
+        }
+    }, stripes);
+}
@@ -0,0 +1,95 @@
+/**
+ * Face Parts
+ *
+ * Search the parts of the faces (eyes, nose, mouth) only in the band of each
+ * face where they can be, with minimum and maximum sizes relative to the size
+ * of the face, instead of scanning the whole face at every scale.
+ *
+ * The face ROI is extracted once, scaled down if the face is larger than
+ * needed to find its parts, and used by the cascades of all the parts. The
+ * faces are searched in parallel, a cascade can not be used by two threads
+ * at the same time so PartDetector keeps a copy of the cascade for each
+ * thread.
+ *
+ */
+
+#ifndef FACE_PARTS_h
+#define FACE_PARTS_h
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/objdetect.hpp>
+
+/**
+ * ROI of a face shared by the cascades of its parts
+ */
+struct FaceRegion {
+    // Face in the frame
+    cv::Rect face;
+    // Gray face ROI, scaled if the face is wider than the maximum width
+    cv::Mat gray;
+    // Pixels of the ROI by pixel of the frame
+    double scale;
+};
+
+/**
+ * Extract the ROI of a face, reusing the buffer of the region
+ * @param frameGray equalized gray frame
+ * @param face face in the frame
+ * @param maxWidth faces wider than this are scaled down to this width
+ * @param region output region
+ */
+void prepareFaceRegion(const cv::Mat &frameGray, const cv::Rect &face, int maxWidth, FaceRegion &region);
+
+/**
+ * Where a part is searched, in fractions of the face
+ */
+struct PartSearch {
+    // Band of rows of the face
+    float top, bottom;
+    // Minimum and maximum size of the part relative to the face width
+    float minSize, maxSize;
+    int minNeighbors;
+};
+
+extern const PartSearch eyeSearch;
+extern const PartSearch noseSearch;
+extern const PartSearch mouthSearch;
+
+/**
+ * Search a part in the band of a face
+ * @param cascade cascade of the part
+ * @param region face ROI
+ * @param search band and sizes of the part
+ * @param parts output boxes of the parts in frame coordinates
+ */
+void detectPart(cv::CascadeClassifier &cascade, const FaceRegion &region, const PartSearch &search,
+                std::vector<cv::Rect> &parts);
+
+/**
+ * Detector of a part in several faces in parallel
+ */
+class PartDetector {
+public:
+    /**
+     * Load a copy of the cascade for each thread of the OpenCV pool
+     * @return false if the cascade can not be loaded
+     */
+    bool load(const std::string &file);
+
+    /**
+     * Search the part in all the faces in parallel
+     * @param regions face ROIs
+     * @param search band and sizes of the part
+     * @param parts output boxes of the parts of each face in frame coordinates
+     */
+    void detect(const std::vector<FaceRegion> &regions, const PartSearch &search,
+                std::vector<std::vector<cv::Rect> > &parts);
+
+private:
+    std::vector<cv::CascadeClassifier> cascades;
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include "FaceTracker.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+
+using namespace cv;
+using namespace std;
+
+// Points tracked inside each box
+const int maxPointsPerTrack = 20;
+// A box needs at least this number of points to be tracked
+const int minPointsPerTrack = 4;
+
+static float median(vector<float> &values) {
+    size_t n = values.size() / 2;
+    nth_element(values.begin(), values.begin() + n, values.end());
+    return values[n];
+}
+
+FaceTracker::FaceTracker(ObjectDetector detector, int detectEvery, double minConfidence)
+        : detector(detector), detectEvery(max(1, detectEvery)), minConfidence(minConfidence),
+          sinceDetection(0), stats(TrackerStats()), firstTick(0), lastTick(0) {
+}
+
+const vector<Rect> &FaceTracker::update(const Mat &gray) {
+    lastTick = getTickCount();
+    if (stats.frames == 0)
+        firstTick = lastTick;
+    stats.frames++;
+
+    // Track the boxes, then detect in its turn or if the tracking was lost
+    bool tracked = !prevGray.empty() && track(gray);
+    if (!tracked || ++sinceDetection >= detectEvery) {
+        if (!tracked && sinceDetection + 1 < detectEvery && stats.detections > 0)
+            stats.forcedDetections++;
+        detect(gray);
+        sinceDetection = 0;
+    }
+    gray.copyTo(prevGray);
+
+    // Boxes inside the frame, so they can be used as ROI
+    Rect frameRect(0, 0, gray.cols, gray.rows);
+    boxes.clear();
+    for (auto &t: tracks) {
+        Rect box = Rect(t.box) & frameRect;
+        if (box.area() > 0)
+            boxes.push_back(box);
+    }
+    return boxes;
+}
+
+void FaceTracker::detect(const Mat &gray) {
+    vector<Rect> detected;
+    detector(gray, detected);
+    stats.detections++;
+    if (!tracks.empty())
+        measureDrift(detected);
+
+    tracks.clear();
+    for (auto &object: detected) {
+        Track t;
+        t.box = object;
+        // Corners inside the box, far from its borders that usually are background
+        Rect inner(object.x + object.width / 6, object.y + object.height / 6,
+                   object.width * 2 / 3, object.height * 2 / 3);
+        inner &= Rect(0, 0, gray.cols, gray.rows);
+        if (inner.area() > 0) {
+            goodFeaturesToTrack(gray(inner), t.points, maxPointsPerTrack, 0.01, 3);
+            for (auto &p: t.points)
+                p += Point2f((float) inner.x, (float) inner.y);
+        }
+        // Flat boxes without corners are tracked with a grid of points
+        if ((int) t.points.size() < minPointsPerTrack) {
+            t.points.clear();
+            for (int gy = 1; gy <= 4; gy++)
+                for (int gx = 1; gx <= 4; gx++)
+                    t.points.push_back(Point2f(inner.x + inner.width * gx / 5.0f, inner.y + inner.height * gy / 5.0f));
+        }
+        tracks.push_back(t);
+    }
+}
+
+bool FaceTracker::track(const Mat &gray) {
+    if (tracks.empty())
+        return true;
+    // Track the points of all the boxes with one call
+    prevPoints.clear();
+    for (auto &t: tracks)
+        prevPoints.insert(prevPoints.end(), t.points.begin(), t.points.end());
+    calcOpticalFlowPyrLK(prevGray, gray, prevPoints, nextPoints, status, err, Size(15, 15), 2);
+
+    bool confident = true;
+    size_t first = 0;
+    vector<float> dx, dy, ratio;
+    for (auto &t: tracks) {
+        size_t count = t.points.size();
+        Point2f prevCenter(0, 0), nextCenter(0, 0);
+        vector<Point2f> kept;
+        dx.clear();
+        dy.clear();
+        for (size_t i = first; i < first + count; i++) {
+            if (!status[i])
+                continue;
+            dx.push_back(nextPoints[i].x - prevPoints[i].x);
+            dy.push_back(nextPoints[i].y - prevPoints[i].y);
+            prevCenter += prevPoints[i];
+            nextCenter += nextPoints[i];
+            kept.push_back(nextPoints[i]);
+        }
+        if ((int) kept.size() < minPointsPerTrack || kept.size() < minConfidence * count) {
+            confident = false;
+            first += count;
+            continue;
+        }
+        prevCenter *= 1.0f / kept.size();
+        nextCenter *= 1.0f / kept.size();
+        // Scale with the median change of the distance of the points to their center
+        ratio.clear();
+        for (size_t i = first, k = 0; i < first + count; i++) {
+            if (!status[i])
+                continue;
+            float prevDistance = (float) norm(prevPoints[i] - prevCenter);
+            if (prevDistance > 1)
+                ratio.push_back((float) norm(kept[k] - nextCenter) / prevDistance);
+            k++;
+        }
+        float scale = ratio.empty() ? 1.0f : median(ratio);
+        Point2f center(t.box.x + t.box.width * 0.5f + median(dx), t.box.y + t.box.height * 0.5f + median(dy));
+        t.box.width *= scale;
+        t.box.height *= scale;
+        t.box.x = center.x - t.box.width * 0.5f;
+        t.box.y = center.y - t.box.height * 0.5f;
+        t.points = kept;
+        first += count;
+    }
+    return confident;
+}
+
+void FaceTracker::measureDrift(const vector<Rect> &detected) {
+    // Each detection against the tracked box that overlaps it most
+    for (auto &object: detected) {
+        double bestIoU = 0;
+        Rect2f best;
+        for (auto &t: tracks) {
+            Rect2f o(object);
+            double inter = (o & t.box).area();
+            double iou = inter / (o.area() + t.box.area() - inter);
+            if (iou > bestIoU) {
+                bestIoU = iou;
+                best = t.box;
+            }
+        }
+        if (bestIoU <= 0)
+            continue;
+        Point2f objectCenter(object.x + object.width * 0.5f, object.y + object.height * 0.5f);
+        Point2f trackCenter(best.x + best.width * 0.5f, best.y + best.height * 0.5f);
+        stats.sumIoU += bestIoU;
+        stats.sumCenterError += norm(objectCenter - trackCenter);
+        stats.matched++;
+    }
+}
+
+string FaceTracker::report() const {
+    double seconds = (lastTick - firstTick) / getTickFrequency();
+    char line[256];
+    snprintf(line, sizeof(line),
+             "frames: %d, fps: %.1f, detections: %d (%d forced), drift: mean IoU %.3f, mean center error %.1f px",
+             stats.frames, seconds > 0 ? (stats.frames - 1) / seconds : 0.0, stats.detections, stats.forcedDetections,
+             stats.matched > 0 ? stats.sumIoU / stats.matched : 0.0,
+             stats.matched > 0 ? stats.sumCenterError / stats.matched : 0.0);
+    return line;
+}
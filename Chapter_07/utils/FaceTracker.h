@@ -0,0 +1,95 @@
+/**
+ * Face Tracker
+ *
+ * Run the face detector only every N frames and follow the faces between
+ * detections with pyramidal Lucas-Kanade optical flow over a few points
+ * inside each box. The box of each face moves with the median motion of its
+ * points and scales with the median change of their distance to its center.
+ *
+ * A detection is also run before its turn when a face loses too many of its
+ * points. In the detection frames the tracked boxes are compared with the
+ * detected ones to measure the drift of the tracking.
+ *
+ */
+
+#ifndef FACE_TRACKER_h
+#define FACE_TRACKER_h
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+/**
+ * Detector of the tracked objects in a gray frame
+ */
+typedef std::function<void(const cv::Mat &gray, std::vector<cv::Rect> &objects)> ObjectDetector;
+
+/**
+ * Statistics of the tracking
+ */
+struct TrackerStats {
+    int frames;
+    int detections;
+    // Detections run before their turn because the tracking was lost
+    int forcedDetections;
+    // Sum of the best IoU and center error of the detected boxes against the tracked ones
+    double sumIoU;
+    double sumCenterError;
+    int matched;
+    double seconds;
+};
+
+class FaceTracker {
+public:
+    /**
+     * Constructor
+     *
+     * @param detector function that detects the objects in a gray frame
+     * @param detectEvery run the detector every detectEvery frames, 1 detects in all frames
+     * @param minConfidence fraction of the points of a box that must be tracked, else it is detected again
+     */
+    FaceTracker(ObjectDetector detector, int detectEvery = 5, double minConfidence = 0.5);
+
+    /**
+     * Boxes of the objects in a new frame, detected or tracked
+     * @param gray equalized gray frame
+     * @return boxes of the objects, inside the frame
+     */
+    const std::vector<cv::Rect> &update(const cv::Mat &gray);
+
+    const TrackerStats &getStats() const { return stats; }
+
+    /**
+     * FPS, detections and drift of the tracked boxes
+     */
+    std::string report() const;
+
+private:
+    struct Track {
+        cv::Rect2f box;
+        std::vector<cv::Point2f> points;
+    };
+
+    void detect(const cv::Mat &gray);
+
+    bool track(const cv::Mat &gray);
+
+    void measureDrift(const std::vector<cv::Rect> &detected);
+
+    ObjectDetector detector;
+    int detectEvery;
+    double minConfidence;
+    int sinceDetection;
+    std::vector<Track> tracks;
+    std::vector<cv::Rect> boxes;
+    cv::Mat prevGray;
+    std::vector<cv::Point2f> prevPoints, nextPoints;
+    std::vector<unsigned char> status;
+    std::vector<float> err;
+    TrackerStats stats;
+    int64_t firstTick, lastTick;
+};
+
+#endif
@@ -0,0 +1,108 @@
+/**
+ * Frame Source
+ *
+ * Source of the frames of the webcam applications. By default it is the
+ * webcam, as the VideoCapture it replaces, but it can also replay a video
+ * file, an image sequence with a printf pattern (frame_%04d.png) or the
+ * images of a glob (the png of a directory, in name order), so the
+ * applications can be benchmarked and tested without a camera.
+ *
+ * A replayed input delivers all its frames, in the same order in each run.
+ * It runs free, as fast as the application reads the frames, or paced at the
+ * frame rate of the input, and it is replayed a number of times.
+ *
+ */
+
+#ifndef FRAME_SOURCE_h
+#define FRAME_SOURCE_h
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/videoio.hpp>
+
+// Keys of the command line parser read by FrameSource::open(parser)
+#define FRAME_SOURCE_KEYS \
+        "{input | | Video file or image sequence (frame_%04d.png or 'frames/*.png') to replay instead of the webcam}" \
+        "{paced | | Replay the input at its frame rate instead of as fast as possible}" \
+        "{fps | 0 | Frame rate of the paced replay, 0 uses the one of the video or 30}" \
+        "{loops | 1 | Number of times the input is replayed, 0 replays it forever}"
+
+class FrameSource {
+public:
+    FrameSource();
+
+    /**
+     * Open the webcam or an input to replay
+     * @param input video, image sequence or glob, empty or a number opens that camera
+     * @param camera camera opened when the input is empty
+     * @param apiPreference backend of the camera
+     * @return true if it can be read
+     */
+    bool open(const std::string &input, int camera = 0, int apiPreference = cv::CAP_ANY);
+
+    /**
+     * Open the input, pacing and loops of the FRAME_SOURCE_KEYS of the parser
+     */
+    bool open(const cv::CommandLineParser &parser, int camera = 0, int apiPreference = cv::CAP_ANY);
+
+    /**
+     * Replay at the frame rate of the input, or at fps if it is greater than 0
+     */
+    void setPaced(bool paced, double fps = 0);
+
+    /**
+     * Number of times the input is replayed, 0 replays it forever
+     */
+    void setLoops(int loops);
+
+    bool isOpened() const;
+
+    /**
+     * Whether the frames come from a camera
+     */
+    bool isLive() const;
+
+    /**
+     * Next frame
+     * @return false, and an empty frame, at the end of the last loop
+     */
+    bool read(cv::Mat &frame);
+
+    FrameSource &operator>>(cv::Mat &frame);
+
+    /**
+     * Delay for waitKey, liveDelay with a camera and the minimum with a
+     * replay, that is paced by the source itself
+     */
+    int waitDelay(int liveDelay) const;
+
+    void release();
+
+    /**
+     * Frames read and frame rate since the first frame
+     */
+    std::string report() const;
+
+private:
+    bool rewind();
+
+    bool readNext(cv::Mat &frame);
+
+    std::string input;
+    bool live;
+    bool paced;
+    double fps;
+    int loops;
+    int loop;
+    cv::VideoCapture capture;
+    // Images of a glob and next one to read
+    std::vector<cv::String> files;
+    size_t nextFile;
+    long frames;
+    cv::int64 start;
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "MultiCascadeDetector.h"
+
+#include <algorithm>
+
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "CascadeCache.h"
+
+using namespace cv;
+using namespace std;
+
+// Same grouping than detectMultiScale
+static const double groupEps = 0.2;
+
+// detectMultiScale scans the levels reduced this many times or more at every pixel, and the
+// others every 2 pixels; a level given already resized is scanned as a level of factor 1
+static const double fullStepFactor = 2;
+
+MultiCascadeDetector::MultiCascadeDetector(double scaleFactor, int minNeighbors, Size minSize)
+        : scaleFactor(scaleFactor), minNeighbors(minNeighbors), minSize(minSize), evaluations(0) {
+    copies.resize(max(1, getNumThreads()));
+}
+
+bool MultiCascadeDetector::add(const string &file) {
+    for (auto &threadCopies: copies) {
+        // Each copy is loaded, copies of a CascadeClassifier share their state
+        threadCopies.push_back(CascadeClassifier());
+        if (!loadCascade(threadCopies.back(), file))
+            return false;
+    }
+    windows.push_back(copies[0].back().getOriginalWindowSize());
+    return true;
+}
+
+size_t MultiCascadeDetector::size() const {
+    return windows.size();
+}
+
+void MultiCascadeDetector::detect(const Mat &gray, vector<vector<Rect> > &objects) {
+    objects.assign(windows.size(), vector<Rect>());
+    if (windows.empty())
+        return;
+
+    // Scales where the window of any cascade fits in the frame
+    Size smallest = windows[0];
+    for (auto &window: windows) {
+        smallest.width = min(smallest.width, window.width);
+        smallest.height = min(smallest.height, window.height);
+    }
+    factors.clear();
+    for (double factor = 1; cvRound(smallest.width * factor) <= gray.cols &&
+                            cvRound(smallest.height * factor) <= gray.rows; factor *= scaleFactor)
+        factors.push_back(factor);
+
+    // The pyramid, once for all the cascades; the levels scanned at every pixel are left to
+    // detectMultiScale, they are small and cheap
+    levels.resize(factors.size());
+    parallel_for_(Range(0, (int) factors.size()), [&](const Range &range) {
+        for (int l = range.start; l < range.end; l++) {
+            Size size(cvRound(gray.cols / factors[l]), cvRound(gray.rows / factors[l]));
+            if (l == 0)
+                levels[l] = gray;
+            else if (factors[l] < fullStepFactor)
+                resize(gray, levels[l], size, 0, 0, INTER_LINEAR);
+            else
+                levels[l].release();
+        }
+    });
+
+    // Pairs of level and cascade where the scaled window is not under the minimum size
+    vector<pair<int, int> > tasks;
+    for (int l = 0; l < (int) factors.size(); l++) {
+        for (int c = 0; c < (int) windows.size(); c++) {
+            Size scaled(cvRound(windows[c].width * factors[l]), cvRound(windows[c].height * factors[l]));
+            if (scaled.width >= minSize.width && scaled.height >= minSize.height &&
+                windows[c].width <= cvRound(gray.cols / factors[l]) &&
+                windows[c].height <= cvRound(gray.rows / factors[l]))
+                tasks.push_back(make_pair(l, c));
+        }
+    }
+    evaluations = (int) tasks.size();
+
+    // Each stripe uses its own copies and the tasks stripe, stripe + stripes...
+    vector<vector<Rect> > candidates(tasks.size());
+    int stripes = (int) min(copies.size(), tasks.size());
+    parallel_for_(Range(0, stripes), [&](const Range &range) {
+        for (int s = range.start; s < range.end; s++) {
+            for (size_t t = s; t < tasks.size(); t += stripes) {
+                int l = tasks[t].first, c = tasks[t].second;
+                if (factors[l] >= fullStepFactor) {
+                    // Only the scaled window over the frame, detectMultiScale reaches the same factor
+                    // and scans it at every pixel, without grouping
+                    Size scaled(cvRound(windows[c].width * factors[l]), cvRound(windows[c].height * factors[l]));
+                    copies[s][c].detectMultiScale(gray, candidates[t], scaleFactor, 0, 0, scaled, scaled);
+                    continue;
+                }
+                // Only the original window size, without grouping
+                copies[s][c].detectMultiScale(levels[l], candidates[t], scaleFactor, 0, 0, windows[c], windows[c]);
+                for (auto &candidate: candidates[t]) {
+                    candidate = Rect(cvRound(candidate.x * factors[l]), cvRound(candidate.y * factors[l]),
+                                     cvRound(candidate.width * factors[l]), cvRound(candidate.height * factors[l]));
+                }
+            }
+        }
+    }, stripes);
+
+    for (size_t t = 0; t < tasks.size(); t++) {
+        auto &cascadeObjects = objects[tasks[t].second];
+        cascadeObjects.insert(cascadeObjects.end(), candidates[t].begin(), candidates[t].end());
+    }
+    for (auto &cascadeObjects: objects)
+        groupRectangles(cascadeObjects, minNeighbors, groupEps);
+}
+
+int MultiCascadeDetector::getLevels() const {
+    return (int) levels.size();
+}
+
+int MultiCascadeDetector::getEvaluations() const {
+    return evaluations;
+}
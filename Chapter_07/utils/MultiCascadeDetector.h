@@ -0,0 +1,74 @@
+/**
+ * Multi Cascade Detector
+ *
+ * Evaluate several cascades (the left and right ears) on the same frame with
+ * a single scale pyramid. detectMultiScale builds the pyramid of the frame in
+ * each call; here the levels are resized once, and each cascade is evaluated
+ * on each level at its original window size, all the pairs of level and
+ * cascade in parallel. The candidates of all the levels are grouped as
+ * detectMultiScale does.
+ *
+ * detectMultiScale scans the levels reduced less than 2 times every 2 pixels
+ * and the rest at every pixel, but a level given already resized is always
+ * scanned every 2 pixels. So only the levels under 2 are shared; for the rest
+ * each cascade is run over the frame with only its scaled window, as
+ * detectMultiScale does. Only the resizes are shared: the integral images
+ * are still computed for each pair of level and cascade.
+ *
+ * A cascade can not be used by two threads at the same time, so each thread
+ * has its own copy of the cascades.
+ *
+ */
+
+#ifndef MULTI_CASCADE_DETECTOR_h
+#define MULTI_CASCADE_DETECTOR_h
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/objdetect.hpp>
+
+class MultiCascadeDetector {
+public:
+    /**
+     * Same parameters as detectMultiScale
+     */
+    MultiCascadeDetector(double scaleFactor = 1.1, int minNeighbors = 2, cv::Size minSize = cv::Size(30, 30));
+
+    /**
+     * Load a cascade, its objects are the index of the order of the calls
+     * @return false if it can not be loaded
+     */
+    bool add(const std::string &file);
+
+    size_t size() const;
+
+    /**
+     * Detect the objects of all the cascades
+     * @param gray gray frame
+     * @param objects output objects of each cascade
+     */
+    void detect(const cv::Mat &gray, std::vector<std::vector<cv::Rect> > &objects);
+
+    /**
+     * Levels of the pyramid and cascade evaluations of the last frame
+     */
+    int getLevels() const;
+
+    int getEvaluations() const;
+
+private:
+    double scaleFactor;
+    int minNeighbors;
+    cv::Size minSize;
+    // Copies of the cascades of each thread
+    std::vector<std::vector<cv::CascadeClassifier> > copies;
+    std::vector<cv::Size> windows;
+    // Pyramid of the last frame
+    std::vector<cv::Mat> levels;
+    std::vector<double> factors;
+    int evaluations;
+};
+
+#endif
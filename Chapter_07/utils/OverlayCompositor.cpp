@@ -0,0 +1,119 @@
+#include "OverlayCompositor.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/imgproc.hpp>
+
+using namespace cv;
+using namespace std;
+
+OverlayCompositor::OverlayCompositor(const Mat &mask, int thresh, int bucket, size_t capacity)
+        : mask(mask), bucket(max(1, bucket)), capacity(max((size_t) 1, capacity)), hits(0), misses(0) {
+    if (!mask.empty()) {
+        CV_Assert(mask.type() == CV_8UC3);
+        Mat gray;
+        cvtColor(mask, gray, COLOR_BGR2GRAY);
+        threshold(gray, maskAlpha, thresh, 255, THRESH_BINARY_INV);
+    }
+}
+
+const OverlayCompositor::Sprite &OverlayCompositor::sprite(const Size &size) {
+    // Nearest multiple of the bucket
+    Size bucketSize(max(bucket, (size.width + bucket / 2) / bucket * bucket),
+                    max(bucket, (size.height + bucket / 2) / bucket * bucket));
+    pair<int, int> key(bucketSize.width, bucketSize.height);
+    auto found = index.find(key);
+    if (found != index.end()) {
+        hits++;
+        sprites.splice(sprites.begin(), sprites, found->second);
+        return sprites.front();
+    }
+
+    misses++;
+    if (sprites.size() >= capacity) {
+        index.erase(make_pair(sprites.back().size.width, sprites.back().size.height));
+        sprites.pop_back();
+    }
+    Sprite sprite;
+    sprite.size = bucketSize;
+    int interpolation = bucketSize.area() < mask.size().area() ? INTER_AREA : INTER_LINEAR;
+    resize(mask, sprite.bgr, bucketSize, 0, 0, interpolation);
+    // The resized alpha is soft in the borders of the mask
+    resize(maskAlpha, sprite.alpha, bucketSize, 0, 0, interpolation);
+    sprites.push_front(sprite);
+    index[key] = sprites.begin();
+    return sprites.front();
+}
+
+#if CV_SIMD
+
+/**
+ * Blend of one channel of the lanes, in 16 bits: the products and their sum
+ * are at most 255 * 255 + 128, and the division by 255 is done with shifts
+ */
+static inline v_uint8 blendLanes(const v_uint8 &src, const v_uint8 &dst, const v_uint16 &alpha0,
+                                 const v_uint16 &alpha1) {
+    v_uint16 src0, src1, dst0, dst1;
+    v_expand(src, src0, src1);
+    v_expand(dst, dst0, dst1);
+    v_uint16 v255 = vx_setall_u16(255), v128 = vx_setall_u16(128);
+    v_uint16 v0 = v_mul_wrap(src0, alpha0) + v_mul_wrap(dst0, v255 - alpha0) + v128;
+    v_uint16 v1 = v_mul_wrap(src1, alpha1) + v_mul_wrap(dst1, v255 - alpha1) + v128;
+    return v_pack((v0 + (v0 >> 8)) >> 8, (v1 + (v1 >> 8)) >> 8);
+}
+
+#endif
+
+/**
+ * dst = (src * alpha + dst * (255 - alpha)) / 255, a vector of pixels at a
+ * time with the universal intrinsics and the last ones one by one
+ */
+static void blendRow(const uchar *src, const uchar *alpha, uchar *dst, int width) {
+    int x = 0;
+#if CV_SIMD
+    const int lanes = v_uint8::nlanes;
+    for (; x <= width - lanes; x += lanes) {
+        v_uint16 alpha0, alpha1;
+        v_expand(vx_load(alpha + x), alpha0, alpha1);
+        v_uint8 srcB, srcG, srcR, dstB, dstG, dstR;
+        v_load_deinterleave(src + 3 * x, srcB, srcG, srcR);
+        v_load_deinterleave(dst + 3 * x, dstB, dstG, dstR);
+        v_store_interleave(dst + 3 * x, blendLanes(srcB, dstB, alpha0, alpha1),
+                           blendLanes(srcG, dstG, alpha0, alpha1), blendLanes(srcR, dstR, alpha0, alpha1));
+    }
+#endif
+    for (; x < width; x++) {
+        unsigned a = alpha[x];
+        for (int c = 0; c < 3; c++) {
+            // Division by 255 with rounding
+            unsigned v = src[3 * x + c] * a + dst[3 * x + c] * (255 - a) + 128;
+            dst[3 * x + c] = (uchar) ((v + (v >> 8)) >> 8);
+        }
+    }
+}
+
+void OverlayCompositor::overlay(Mat &frame, const Rect &box) {
+    if (mask.empty() || box.width <= 0 || box.height <= 0)
+        return;
+    CV_Assert(frame.type() == CV_8UC3);
+    const Sprite &s = sprite(box.size());
+    Rect target(box.x + (box.width - s.size.width) / 2, box.y + (box.height - s.size.height) / 2,
+                s.size.width, s.size.height);
+    Rect visible = target & Rect(0, 0, frame.cols, frame.rows);
+    if (visible.empty())
+        return;
+    int offsetX = visible.x - target.x;
+    int offsetY = visible.y - target.y;
+    for (int y = 0; y < visible.height; y++) {
+        blendRow(s.bgr.ptr<uchar>(offsetY + y) + offsetX * 3, s.alpha.ptr<uchar>(offsetY + y) + offsetX,
+                 frame.ptr<uchar>(visible.y + y) + visible.x * 3, visible.width);
+    }
+}
+
+string OverlayCompositor::report() const {
+    stringstream ss;
+    ss << "Overlay cache: " << sprites.size() << " sizes, " << hits << " hits, " << misses << " misses";
+    return ss.str();
+}
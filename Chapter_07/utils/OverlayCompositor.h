@@ -0,0 +1,67 @@
+/**
+ * Overlay Compositor
+ *
+ * Blend a mask image (sunglasses, moustache...) over the frame. The mask is
+ * thresholded once to get its alpha, and the mask and alpha resized to each
+ * size are kept in a LRU cache. The sizes are rounded to buckets of a few
+ * pixels so a face that moves does not resize the mask again in each frame.
+ *
+ * The sprite is blended into the frame in a single pass over the pixels,
+ * clipped to the frame, instead of the resize, cvtColor, threshold,
+ * bitwise_not, bitwise_and and add of each overlay. The blend uses the
+ * universal intrinsics of OpenCV, a vector of pixels at a time.
+ *
+ */
+
+#ifndef OVERLAY_COMPOSITOR_h
+#define OVERLAY_COMPOSITOR_h
+
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <opencv2/core.hpp>
+
+class OverlayCompositor {
+public:
+    /**
+     * @param mask BGR mask image, its pixels brighter than thresh are background
+     * @param thresh gray level of the background of the mask
+     * @param bucket sizes are rounded to multiples of bucket pixels
+     * @param capacity maximum number of sizes in the cache
+     */
+    OverlayCompositor(const cv::Mat &mask, int thresh, int bucket = 8, size_t capacity = 32);
+
+    /**
+     * Blend the mask resized to the box, centered in it and clipped to the frame
+     * @param frame BGR frame
+     * @param box place of the mask, it can be partially outside of the frame
+     */
+    void overlay(cv::Mat &frame, const cv::Rect &box);
+
+    /**
+     * Cache hits and misses
+     */
+    std::string report() const;
+
+private:
+    struct Sprite {
+        cv::Size size;
+        cv::Mat bgr;
+        cv::Mat alpha;
+    };
+
+    const Sprite &sprite(const cv::Size &size);
+
+    cv::Mat mask;
+    cv::Mat maskAlpha;
+    int bucket;
+    size_t capacity;
+    // Most recently used first
+    std::list<Sprite> sprites;
+    std::map<std::pair<int, int>, std::list<Sprite>::iterator> index;
+    long hits, misses;
+};
+
+#endif
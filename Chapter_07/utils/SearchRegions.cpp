@@ -0,0 +1,126 @@
+#include "SearchRegions.h"
+
+#include <algorithm>
+#include <sstream>
+
+using namespace cv;
+using namespace std;
+
+SearchRegions::SearchRegions(ObjectDetector detector, int fullEvery, double margin)
+        : objectDetector(detector), fullEvery(max(1, fullEvery)), margin(margin), sinceFull(0) {
+    stats = SearchStats();
+}
+
+static Point2f center(const Rect &box) {
+    return Point2f(box.x + box.width * 0.5f, box.y + box.height * 0.5f);
+}
+
+/**
+ * Join the overlapping regions, so each pixel is scanned once and a face in
+ * two regions is not found twice
+ */
+static void mergeRegions(vector<Rect> &regions) {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < regions.size() && !merged; i++) {
+            for (size_t j = i + 1; j < regions.size() && !merged; j++) {
+                if ((regions[i] & regions[j]).area() > 0) {
+                    regions[i] |= regions[j];
+                    regions.erase(regions.begin() + j);
+                    merged = true;
+                }
+            }
+        }
+    }
+}
+
+void SearchRegions::fullScan(const Mat &gray, vector<Rect> &objects) {
+    objectDetector(gray, objects);
+    stats.fullScans++;
+    stats.pixels += gray.total();
+    sinceFull = 0;
+}
+
+void SearchRegions::detect(const Mat &gray, vector<Rect> &objects) {
+    stats.calls++;
+    if (tracks.empty() || sinceFull + 1 >= fullEvery) {
+        fullScan(gray, objects);
+        updateTracks(objects);
+        return;
+    }
+    sinceFull++;
+
+    // Predicted box of each face enlarged by the margin
+    Rect frameRect(0, 0, gray.cols, gray.rows);
+    vector<Rect> trackRegions;
+    for (auto &track: tracks) {
+        Rect predicted = track.box + Point(cvRound(track.velocity.x), cvRound(track.velocity.y));
+        int dx = cvRound(predicted.width * margin), dy = cvRound(predicted.height * margin);
+        trackRegions.push_back(Rect(predicted.x - dx, predicted.y - dy,
+                                    predicted.width + 2 * dx, predicted.height + 2 * dy) & frameRect);
+    }
+    vector<Rect> regions = trackRegions;
+    mergeRegions(regions);
+
+    objects.clear();
+    vector<Rect> found;
+    for (auto &region: regions) {
+        if (region.empty())
+            continue;
+        objectDetector(gray(region), found);
+        for (auto &object: found)
+            objects.push_back(object + region.tl());
+        stats.pixels += region.area();
+    }
+
+    // Each known face must be found in its region, else it moved faster than predicted
+    for (auto &region: trackRegions) {
+        bool hit = false;
+        for (auto &object: objects)
+            hit = hit || region.contains(center(object));
+        if (!hit) {
+            stats.missScans++;
+            fullScan(gray, objects);
+            break;
+        }
+    }
+    updateTracks(objects);
+}
+
+void SearchRegions::updateTracks(const vector<Rect> &objects) {
+    // Each object continues the nearest track whose center is inside its box
+    vector<Track> updated;
+    for (auto &object: objects) {
+        Track track;
+        track.box = object;
+        track.velocity = Point2f(0, 0);
+        Point2f c = center(object);
+        double best = -1;
+        for (auto &previous: tracks) {
+            Point2f motion = c - center(previous.box);
+            double distance = norm(motion);
+            if (object.contains(center(previous.box)) && (best < 0 || distance < best)) {
+                best = distance;
+                // Smoothed with the previous velocity
+                track.velocity = previous.velocity * 0.5f + motion * 0.5f;
+            }
+        }
+        updated.push_back(track);
+    }
+    tracks = updated;
+}
+
+ObjectDetector SearchRegions::detector() {
+    return [this](const Mat &gray, vector<Rect> &objects) {
+        detect(gray, objects);
+    };
+}
+
+string SearchRegions::report() const {
+    stringstream ss;
+    ss << "Search regions: " << stats.fullScans << " full scans (" << stats.missScans << " after a miss) in "
+       << stats.calls << " detections, " << (stats.calls > 0 ? stats.pixels / stats.calls : 0)
+       << " pixels scanned by detection";
+    return ss.str();
+}
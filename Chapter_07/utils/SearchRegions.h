@@ -0,0 +1,87 @@
+/**
+ * Search Regions
+ *
+ * Detector that does not scan the whole frame for the faces it already
+ * knows. The position of each face is predicted from its velocity between
+ * the last detections, and the detector only scans the predicted box
+ * enlarged by a margin. The whole frame is scanned every fullEvery calls to
+ * find new faces, when there are no faces and when a known face is not found
+ * in its region.
+ *
+ * It wraps an ObjectDetector and it is an ObjectDetector itself, so it can be
+ * used by the FaceTracker.
+ *
+ */
+
+#ifndef SEARCH_REGIONS_h
+#define SEARCH_REGIONS_h
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "FaceTracker.h"
+
+/**
+ * Statistics of the scans
+ */
+struct SearchStats {
+    long calls;
+    long fullScans;
+    // Full scans run before their turn because a face was not found in its region
+    long missScans;
+    // Pixels given to the detector
+    double pixels;
+};
+
+class SearchRegions {
+public:
+    /**
+     * Constructor
+     *
+     * @param detector function that detects the objects in a gray frame or region
+     * @param fullEvery scan the whole frame every fullEvery calls, 1 scans it in all calls
+     * @param margin the predicted box is enlarged by this fraction of its size on each side
+     */
+    SearchRegions(ObjectDetector detector, int fullEvery = 5, double margin = 0.5);
+
+    /**
+     * Detect the objects in the predicted regions or in the whole frame
+     * @param gray gray frame
+     * @param objects output boxes in frame coordinates
+     */
+    void detect(const cv::Mat &gray, std::vector<cv::Rect> &objects);
+
+    /**
+     * This detector as an ObjectDetector, it must outlive the returned function
+     */
+    ObjectDetector detector();
+
+    const SearchStats &getStats() const { return stats; }
+
+    /**
+     * Full scans and pixels scanned by call
+     */
+    std::string report() const;
+
+private:
+    struct Track {
+        cv::Rect box;
+        // Motion of the center between calls
+        cv::Point2f velocity;
+    };
+
+    void fullScan(const cv::Mat &gray, std::vector<cv::Rect> &objects);
+
+    void updateTracks(const std::vector<cv::Rect> &objects);
+
+    ObjectDetector objectDetector;
+    int fullEvery;
+    double margin;
+    int sinceFull;
+    std::vector<Track> tracks;
+    SearchStats stats;
+};
+
+#endif
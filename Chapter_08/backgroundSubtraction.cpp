@@ -8,35 +8,81 @@
 #include <sstream>
 #include <memory>
 
+#include "utils/BackgroundStage.h"
+#include "utils/FrameSource.h"
+#include "utils/GaussianMixture.h"
+
 using namespace cv;
 using namespace std;
 
+const char *keys =
+        {
+                "{help h usage ? | | print this message}"
+                BACKGROUND_STAGE_KEYS
+                "{snapshot | | File where the background model is saved, and restored from on start}"
+                "{snapshot_every | 300 | Frames between the saves of the snapshot, 0 saves it only on exit}"
+                FRAME_SOURCE_KEYS
+        };
+
 int main(int argc, char *argv[]) {
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 8. Background subtraction v1.0.0");
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+    string snapshotFile = parser.get<string>("snapshot");
+    int snapshotEvery = parser.get<int>("snapshot_every");
+    if (!parser.check()) {
+        parser.printErrors();
+        return 0;
+    }
+
     // Current frame
     Mat frame;
 
     // Foreground mask generated by MOG2 method
     Mat fgMaskMOG2;
 
-    // MOG2 Background subtractor
-    Ptr<BackgroundSubtractor> pMOG2;
-
     char ch;
 
-    // Create the capture object
-    // 0 -> input arg that specifies it should take the input from the webcam
-    VideoCapture cap(0, CAP_V4L);
+    // Create the capture object, the webcam or the input to replay
+    FrameSource cap;
 
     // If you cannot open the webcam, stop the execution!
-    if (!cap.isOpened())
+    if (!cap.open(parser, 0, CAP_V4L))
         return -1;
 
     //create GUI windows
     namedWindow("Frame");
     namedWindow("FG Mask MOG 2");
 
-    // Create MOG2 Background Subtractor object
-    pMOG2 = createBackgroundSubtractorMOG2();
+    // MOG2 of OpenCV can not be saved, with a snapshot the models are the same mixture in GaussianMixture
+    SubtractorFactory factory;
+    if (!snapshotFile.empty())
+        factory = []() -> Ptr<BackgroundSubtractor> { return makePtr<GaussianMixture>(); };
+
+    // MOG2 Background subtractor, in tiles and over the reduced luma as chosen in the command line
+    BackgroundStage pMOG2(parser, factory);
+
+    // Continue with the model of the last run, if it has the same configuration and frame size
+    if (!snapshotFile.empty()) {
+        int64 start = getTickCount();
+        if (pMOG2.load(snapshotFile))
+            cout << "Background model restored from " << snapshotFile << " in "
+                 << (getTickCount() - start) * 1000.0 / getTickFrequency() << " ms" << endl;
+    }
+    int frames = 0, saves = 0;
+    double saveMs = 0;
+    auto saveSnapshot = [&]() {
+        int64 start = getTickCount();
+        if (pMOG2.save(snapshotFile)) {
+            saveMs += (getTickCount() - start) * 1000.0 / getTickFrequency();
+            saves++;
+        } else {
+            cerr << "Error saving the background model to " << snapshotFile << endl;
+        }
+    };
 
     // Scaling factor to resize the input frames from the webcam
     float scalingFactor = 0.75;
@@ -45,12 +91,19 @@ int main(int argc, char *argv[]) {
     while (true) {
         // Capture the current frame
         cap >> frame;
+        if (frame.empty())
+            break;
 
         // Resize the frame
         resize(frame, frame, Size(), scalingFactor, scalingFactor, INTER_AREA);
 
         // Update the MOG2 background model based on the current frame
-        pMOG2->apply(frame, fgMaskMOG2);
+        pMOG2.apply(frame, fgMaskMOG2);
+        frames++;
+
+        // Save the model periodically, a crash loses at most snapshotEvery frames of learning
+        if (!snapshotFile.empty() && snapshotEvery > 0 && frames % snapshotEvery == 0)
+            saveSnapshot();
 
         // Show the current frame
         imshow("Frame", frame);
@@ -60,12 +113,21 @@ int main(int argc, char *argv[]) {
 
         // Get the keyboard input and check if it's 'Esc'
         // 27 -> ASCII value of 'Esc' key
-        ch = waitKey(30);
+        ch = waitKey(cap.waitDelay(30));
         if (ch == 27) {
             break;
         }
     }
 
+    if (!snapshotFile.empty() && frames > 0) {
+        saveSnapshot();
+        if (saves > 0)
+            cout << "Background model saved " << saves << " times, " << saveMs / saves << " ms each" << endl;
+    }
+
+    cout << pMOG2.report() << endl;
+    cout << cap.report() << endl;
+
     // Release the video capture object
     cap.release();
 
@@ -0,0 +1,137 @@
+// BACKGROUND SUBTRACTION BENCHMARK
+// Replay a clip through MOG2 split in tiles and learning from the reduced
+// luma, and compare the throughput and the masks of each configuration with
+// a plain MOG2 of the color frame
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/video/background_segm.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <sstream>
+
+#include "utils/BackgroundStage.h"
+#include "utils/FrameSource.h"
+
+using namespace cv;
+using namespace std;
+
+const char *keys =
+        {
+                "{help h usage ? | | print this message}"
+                "{tiles | 1,2,4 | Comma separated grids of NxN tiles to compare}"
+                "{downscales | 1,2,4 | Comma separated reductions of the model to compare, 1 is the color frame}"
+                "{edge_threshold | 20 | Difference with the background that makes an edge pixel of the scaled mask foreground}"
+                "{warmup | 50 | Frames not scored while the models learn the background}"
+                FRAME_SOURCE_KEYS
+        };
+
+/**
+ * Comma separated numbers of a key
+ */
+static vector<int> splitList(const string &list) {
+    vector<int> values;
+    stringstream stream(list);
+    string value;
+    while (getline(stream, value, ','))
+        if (atoi(value.c_str()) > 0)
+            values.push_back(atoi(value.c_str()));
+    return values;
+}
+
+/**
+ * Foreground pixels of a mask and of the reference, and the ones in both
+ */
+struct MaskScore {
+    double found;
+    double reference;
+    double both;
+};
+
+int main(int argc, char *argv[]) {
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 8. Background subtraction benchmark v1.0.0");
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+    vector<int> tileList = splitList(parser.get<string>("tiles"));
+    vector<int> downscaleList = splitList(parser.get<string>("downscales"));
+    int edgeThreshold = parser.get<int>("edge_threshold");
+    int warmup = parser.get<int>("warmup");
+    if (!parser.check()) {
+        parser.printErrors();
+        return 0;
+    }
+    if (parser.get<string>("input").empty()) {
+        cerr << "A clip to replay is required, use --input. Exiting!" << endl;
+        return -1;
+    }
+
+    // The reference is a plain MOG2 of the color frame, without the stage
+    Ptr<BackgroundSubtractor> reference = createBackgroundSubtractorMOG2();
+    double referenceSeconds = 0;
+    vector<BackgroundStage> stages;
+    for (auto downscale: downscaleList) {
+        for (auto tiles: tileList)
+            stages.push_back(BackgroundStage(SubtractorFactory(), tiles, downscale, edgeThreshold));
+    }
+    vector<MaskScore> scores(stages.size(), MaskScore());
+    vector<Mat> masks(stages.size());
+
+    FrameSource source;
+    if (!source.open(parser)) {
+        cerr << "Error opening the input. Exiting!" << endl;
+        return -1;
+    }
+
+    // Same scaling as the application
+    float scalingFactor = 0.75;
+    Mat frame, referenceMask, foreground, referenceForeground;
+    int frames = 0;
+    while (source.read(frame)) {
+        resize(frame, frame, Size(), scalingFactor, scalingFactor, INTER_AREA);
+        int64 start = getTickCount();
+        reference->apply(frame, referenceMask);
+        referenceSeconds += (getTickCount() - start) / getTickFrequency();
+        for (size_t s = 0; s < stages.size(); s++)
+            stages[s].apply(frame, masks[s]);
+        frames++;
+        if (frames <= warmup)
+            continue;
+
+        // Only the foreground is scored, the shadows are background
+        compare(referenceMask, 255, referenceForeground, CMP_EQ);
+        double referencePixels = countNonZero(referenceForeground);
+        for (size_t s = 0; s < stages.size(); s++) {
+            compare(masks[s], 255, foreground, CMP_EQ);
+            scores[s].found += countNonZero(foreground);
+            scores[s].reference += referencePixels;
+            bitwise_and(foreground, referenceForeground, foreground);
+            scores[s].both += countNonZero(foreground);
+        }
+    }
+    if (frames <= warmup) {
+        cerr << "The input has no frames after the warmup. Exiting!" << endl;
+        return -1;
+    }
+
+    cout << "Frames: " << frames << " (" << frames - warmup << " scored), threads: " << getNumThreads() << endl;
+    cout << fixed << setprecision(3);
+    cout << left << setw(24) << "Model" << right << setw(10) << "ms/frame" << setw(10) << "Speedup"
+         << setw(11) << "Precision" << setw(10) << "Recall" << setw(10) << "F1" << endl;
+    double referenceMs = referenceSeconds * 1000 / frames;
+    cout << left << setw(24) << "MOG2 (reference)" << right << setw(10) << referenceMs << setw(10) << 1.0 << endl;
+    for (size_t s = 0; s < stages.size(); s++) {
+        double ms = stages[s].getMsPerFrame();
+        double precision = scores[s].found > 0 ? scores[s].both / scores[s].found : 0;
+        double recall = scores[s].reference > 0 ? scores[s].both / scores[s].reference : 0;
+        double f1 = precision + recall > 0 ? 2 * precision * recall / (precision + recall) : 0;
+        cout << left << setw(24) << stages[s].name() << right << setw(10) << ms << setw(10)
+             << (ms > 0 ? referenceMs / ms : 0) << setw(11) << precision << setw(10) << recall
+             << setw(10) << f1 << endl;
+    }
+    return 0;
+}
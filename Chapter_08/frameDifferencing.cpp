@@ -7,10 +7,22 @@
 #include <iostream>
 #include <sstream>
 
+#include "utils/FrameDifferencing.h"
+#include "utils/FrameSource.h"
+
 using namespace cv;
 using namespace std;
 
-Mat frameDiff(Mat prevFrame, Mat curFrame, Mat nextFrame) {
+const char *keys =
+        {
+                "{help h usage ? | | print this message}"
+                "{threshold | 0 | Show only the motion over this difference, 0 shows the difference}"
+                "{compare | | Also run the two absdiff and bitwise_and version and compare the time}"
+                FRAME_SOURCE_KEYS
+        };
+
+// Three pass version, kept to compare it with threeFrameDiff
+Mat frameDiff(const Mat &prevFrame, const Mat &curFrame, const Mat &nextFrame) {
     Mat diffFrames1, diffFrames2, output;
 
     // Compute absolute difference between current frame and the next frame
@@ -25,32 +37,28 @@ Mat frameDiff(Mat prevFrame, Mat curFrame, Mat nextFrame) {
     return output;
 }
 
-Mat getFrame(VideoCapture cap, float scalingFactor) {
-    //float scalingFactor = 0.5;
-    Mat frame, output;
-
-    // Capture the current frame
-    cap >> frame;
-
-    // Resize the frame
-    resize(frame, frame, Size(), scalingFactor, scalingFactor, INTER_AREA);
-
-    // Convert to grayscale
-    cvtColor(frame, output, COLOR_BGR2GRAY);
-
-    return output;
-}
-
 int main(int argc, char *argv[]) {
-    Mat frame, prevFrame, curFrame, nextFrame;
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 8. Frame differencing v1.0.0");
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+    int threshold = parser.get<int>("threshold");
+    bool compare = parser.has("compare");
+    if (!parser.check()) {
+        parser.printErrors();
+        return 0;
+    }
+
+    Mat motion;
     char ch;
 
-    // Create the capture object
-    // 0 -> input arg that specifies it should take the input from the webcam
-    VideoCapture cap(0, CAP_V4L);
+    // Create the capture object, the webcam or the input to replay
+    FrameSource cap;
 
     // If you cannot open the webcam, stop the execution!
-    if (!cap.isOpened())
+    if (!cap.open(parser, 0, CAP_V4L))
         return -1;
 
     //create GUI windows
@@ -59,29 +67,50 @@ int main(int argc, char *argv[]) {
     // Scaling factor to resize the input frames from the webcam
     float scalingFactor = 0.75;
 
-    prevFrame = getFrame(cap, scalingFactor);
-    curFrame = getFrame(cap, scalingFactor);
-    nextFrame = getFrame(cap, scalingFactor);
+    // Previous, current and next frames in three buffers reused for the whole input
+    FrameRing frames(scalingFactor);
+    while (!frames.isFull() && frames.push(cap));
+
+    // With --compare, time of the fused kernel and of the three passes
+    double fusedMs = 0, passesMs = 0;
+    int diffs = 0;
+
+    // Iterate until the user presses the Esc key or the input ends
+    while (frames.isFull()) {
+        int64 start = getTickCount();
+        threeFrameDiff(frames.prev(), frames.cur(), frames.next(), motion, threshold);
+        fusedMs += (getTickCount() - start) * 1000.0 / getTickFrequency();
+        if (compare) {
+            start = getTickCount();
+            frameDiff(frames.prev(), frames.cur(), frames.next());
+            passesMs += (getTickCount() - start) * 1000.0 / getTickFrequency();
+        }
+        diffs++;
 
-    // Iterate until the user presses the Esc key
-    while (true) {
         // Show the object movement
-        imshow("Frame", curFrame);
-        imshow("Object Movement", frameDiff(prevFrame, curFrame, nextFrame));
+        imshow("Frame", frames.cur());
+        imshow("Object Movement", motion);
 
-        // Update the variables and grab the next frame
-        prevFrame = curFrame;
-        curFrame = nextFrame;
-        nextFrame = getFrame(cap, scalingFactor);
+        // Grab the next frame, the oldest one is overwritten
+        if (!frames.push(cap))
+            break;
 
         // Get the keyboard input and check if it's 'Esc'
         // 27 -> ASCII value of 'Esc' key
-        ch = waitKey(30);
+        ch = waitKey(cap.waitDelay(30));
         if (ch == 27) {
             break;
         }
     }
 
+    if (diffs > 0) {
+        cout << "Frame difference: " << fusedMs / diffs << " ms/frame" << endl;
+        if (compare)
+            cout << "Two absdiff and bitwise_and: " << passesMs / diffs << " ms/frame" << endl;
+    }
+
+    cout << cap.report() << endl;
+
     // Release the video capture object
     cap.release();
 
@@ -89,4 +118,4 @@ int main(int argc, char *argv[]) {
     destroyAllWindows();
 
     return 0;
-}
\ No newline at end of file
+}
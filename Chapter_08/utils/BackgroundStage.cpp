@@ -0,0 +1,194 @@
+#include "BackgroundStage.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include <opencv2/imgproc.hpp>
+
+#include "GaussianMixture.h"
+
+using namespace cv;
+using namespace std;
+
+// Magic and version of the snapshots, a different version is not read
+static const char snapshotMagic[8] = {'C', 'V', 'B', 'G', 'S', 'N', 'A', 'P'};
+static const unsigned int snapshotVersion = 1;
+
+/**
+ * Header of a snapshot, 64 bytes so the states of the tiles that follow it are aligned
+ */
+struct SnapshotHeader {
+    char magic[8];
+    unsigned int version;
+    int tiles;
+    int downscale;
+    // Size of the frames of the model
+    int width;
+    int height;
+    char padding[36];
+};
+
+BackgroundStage::BackgroundStage(SubtractorFactory factory, int tiles, int downscale, int edgeThreshold)
+        : factory(factory), tiles(max(tiles, 1)), downscale(max(downscale, 1)), edgeThreshold(edgeThreshold),
+          frames(0), seconds(0) {
+    if (!this->factory)
+        this->factory = []() -> Ptr<BackgroundSubtractor> { return createBackgroundSubtractorMOG2(); };
+}
+
+BackgroundStage::BackgroundStage(const CommandLineParser &parser, SubtractorFactory factory)
+        : BackgroundStage(factory, parser.get<int>("tiles"), parser.get<int>("downscale"),
+                          parser.get<int>("edge_threshold")) {
+}
+
+void BackgroundStage::createTiles(Size size) {
+    rects.clear();
+    models.clear();
+    for (int row = 0; row < tiles; row++) {
+        for (int col = 0; col < tiles; col++) {
+            int x = col * size.width / tiles, y = row * size.height / tiles;
+            int x2 = (col + 1) * size.width / tiles, y2 = (row + 1) * size.height / tiles;
+            rects.push_back(Rect(x, y, x2 - x, y2 - y));
+            models.push_back(factory());
+        }
+    }
+}
+
+void BackgroundStage::apply(const Mat &frame, Mat &mask) {
+    int64 start = getTickCount();
+
+    // The reduced model learns from the luma, the full one from the color frame
+    if (downscale > 1) {
+        cvtColor(frame, luma, COLOR_BGR2GRAY);
+        resize(luma, input, Size(), 1.0 / downscale, 1.0 / downscale, INTER_AREA);
+    } else {
+        input = frame;
+    }
+    if (rects.empty() || rects.back().br() != Point(input.cols, input.rows))
+        createTiles(input.size());
+
+    bool refine = downscale > 1 && edgeThreshold > 0;
+    if (refine)
+        background.create(input.size(), CV_8UC1);
+    // The models write the mask of the frame, or the reduced one that is scaled after
+    Mat &output = downscale > 1 ? modelMask : mask;
+    if (models.size() == 1) {
+        // A single model runs outside parallel_for_, so MOG2 keeps its own row parallelism
+        models[0]->apply(input, output);
+        if (refine)
+            models[0]->getBackgroundImage(background);
+    } else {
+        // Each tile with its own model, writing its mask and background straight into their regions
+        output.create(input.size(), CV_8UC1);
+        parallel_for_(Range(0, (int) models.size()), [&](const Range &range) {
+            for (int t = range.start; t < range.end; t++) {
+                Mat tileMask = output(rects[t]);
+                models[t]->apply(input(rects[t]), tileMask);
+                if (refine) {
+                    Mat tileBackground = background(rects[t]);
+                    models[t]->getBackgroundImage(tileBackground);
+                }
+            }
+        });
+    }
+
+    if (downscale > 1) {
+        resize(modelMask, mask, frame.size(), 0, 0, INTER_LINEAR);
+        if (refine) {
+            resize(background, scaledBackground, frame.size(), 0, 0, INTER_LINEAR);
+            // The interpolated pixels between two values are the edges of the mask, the ones
+            // that differ enough from the background are foreground
+            parallel_for_(Range(0, mask.rows), [&](const Range &range) {
+                for (int y = range.start; y < range.end; y++) {
+                    uchar *m = mask.ptr<uchar>(y);
+                    const uchar *l = luma.ptr<uchar>(y);
+                    const uchar *b = scaledBackground.ptr<uchar>(y);
+                    for (int x = 0; x < mask.cols; x++) {
+                        if (m[x] != 0 && m[x] != 127 && m[x] != 255)
+                            m[x] = abs(l[x] - b[x]) > edgeThreshold ? 255 : 0;
+                    }
+                }
+            });
+        }
+    }
+
+    seconds += (getTickCount() - start) / getTickFrequency();
+    frames++;
+}
+
+bool BackgroundStage::save(const string &file) const {
+    if (models.empty())
+        return false;
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.version = snapshotVersion;
+    header.tiles = tiles;
+    header.downscale = downscale;
+    header.width = rects.back().br().x;
+    header.height = rects.back().br().y;
+
+    // Written to a temporary file and renamed, a crash while saving keeps the previous snapshot
+    string tmpFile = file + ".tmp";
+    {
+        ofstream out(tmpFile.c_str(), ios::binary);
+        out.write((const char *) &header, sizeof(header));
+        for (auto &model: models) {
+            const GaussianMixture *mixture = dynamic_cast<const GaussianMixture *>(model.get());
+            if (!mixture || !mixture->writeState(out)) {
+                out.close();
+                remove(tmpFile.c_str());
+                return false;
+            }
+        }
+        if (!out)
+            return false;
+    }
+#if defined(_WIN32)
+    remove(file.c_str());
+#endif
+    return rename(tmpFile.c_str(), file.c_str()) == 0;
+}
+
+bool BackgroundStage::load(const string &file) {
+    Ptr<MappedSnapshot> snapshot = makePtr<MappedSnapshot>(file);
+    if (!snapshot->data || snapshot->size < sizeof(SnapshotHeader))
+        return false;
+    SnapshotHeader header;
+    memcpy(&header, snapshot->data, sizeof(header));
+    if (memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0 || header.version != snapshotVersion ||
+        header.tiles != tiles || header.downscale != downscale || header.width <= 0 || header.height <= 0)
+        return false;
+
+    createTiles(Size(header.width, header.height));
+    // apply feeds the models with the color frame, or with the reduced luma
+    int channels = downscale > 1 ? 1 : 3;
+    size_t offset = sizeof(header);
+    for (size_t t = 0; t < models.size(); t++) {
+        GaussianMixture *mixture = dynamic_cast<GaussianMixture *>(models[t].get());
+        if (!mixture || !mixture->readState(snapshot, offset, rects[t].size(), channels)) {
+            // The next frame creates new models
+            rects.clear();
+            models.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+string BackgroundStage::name() const {
+    char line[64];
+    if (downscale > 1)
+        snprintf(line, sizeof(line), "%dx%d tiles, luma / %d", tiles, tiles, downscale);
+    else
+        snprintf(line, sizeof(line), "%dx%d tiles, color", tiles, tiles);
+    return line;
+}
+
+string BackgroundStage::report() const {
+    char line[256];
+    snprintf(line, sizeof(line), "Background (%s): %ld frames, %.2f ms/frame", name().c_str(), frames,
+             getMsPerFrame());
+    return line;
+}
@@ -0,0 +1,120 @@
+/**
+ * Background Stage
+ *
+ * Background subtraction of a frame split in a grid of tiles, each with its
+ * own background subtractor, all of them updated in parallel by the thread
+ * pool of OpenCV. The mixture of gaussians of MOG2 is independent for each
+ * pixel, so the tiles give the same mask as a single model of the frame.
+ * OpenCV runs a parallel_for_ inside another one serially, so each tile
+ * runs on one thread; a single tile is applied directly and keeps the row
+ * parallelism of MOG2.
+ *
+ * The model can also learn from the luma of the frame reduced 2 or 4 times.
+ * The mask is scaled back to the size of the frame, and the pixels of its
+ * edges, the ones between two values after the interpolation, are decided
+ * again comparing the luma of the frame with the background image of the
+ * model.
+ *
+ * The models of the tiles can be saved in a snapshot and restored after a
+ * restart, when they are GaussianMixture models.
+ *
+ */
+
+#ifndef BACKGROUND_STAGE_h
+#define BACKGROUND_STAGE_h
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/video/background_segm.hpp>
+
+// Keys of the command line parser read by BackgroundStage(parser)
+#define BACKGROUND_STAGE_KEYS \
+        "{tiles | 1 | Split the frame in a grid of NxN tiles, each with its own model, updated in parallel}" \
+        "{downscale | 1 | Learn the model from the luma of the frame reduced 2 or 4 times, 1 uses the color frame}" \
+        "{edge_threshold | 20 | Difference with the background that makes an edge pixel of the scaled mask foreground, 0 keeps the interpolated mask}"
+
+/**
+ * Creates the model of each tile
+ */
+typedef std::function<cv::Ptr<cv::BackgroundSubtractor>()> SubtractorFactory;
+
+class BackgroundStage {
+public:
+    /**
+     * Constructor
+     *
+     * @param factory creates the model of each tile, a MOG2 with its default parameters if it is empty
+     * @param tiles the frame is split in tiles x tiles tiles
+     * @param downscale 1 learns from the color frame, 2 or 4 from the luma reduced that many times
+     * @param edgeThreshold difference of the luma with the background that makes an edge pixel foreground
+     */
+    BackgroundStage(SubtractorFactory factory = SubtractorFactory(), int tiles = 1, int downscale = 1,
+                    int edgeThreshold = 20);
+
+    /**
+     * Constructor with the BACKGROUND_STAGE_KEYS of the command line
+     */
+    BackgroundStage(const cv::CommandLineParser &parser, SubtractorFactory factory = SubtractorFactory());
+
+    /**
+     * Update the models with a frame and get its foreground mask
+     * @param frame color frame
+     * @param mask 255 in the foreground, 127 in the shadows and 0 in the background
+     */
+    void apply(const cv::Mat &frame, cv::Mat &mask);
+
+    /**
+     * Save the models of all the tiles in a snapshot: a header with the
+     * configuration and the size of the model, followed by the state of each
+     * tile. The file is written to a temporary one and renamed.
+     * @return false if there is no model yet or they are not GaussianMixture models
+     */
+    bool save(const std::string &file) const;
+
+    /**
+     * Restore the models of a snapshot of a stage with the same tiles and
+     * downscale, they continue from the next frame if it has the same size
+     * @return false if the snapshot can not be read or it is of another configuration
+     */
+    bool load(const std::string &file);
+
+    /**
+     * Description of the configuration, as "2x2 tiles, luma / 2"
+     */
+    std::string name() const;
+
+    /**
+     * Mean time of apply in ms
+     */
+    double getMsPerFrame() const { return frames > 0 ? seconds * 1000 / frames : 0.0; }
+
+    /**
+     * Frames and mean time of apply
+     */
+    std::string report() const;
+
+private:
+    /**
+     * Split a frame size in the tiles and create their models
+     */
+    void createTiles(cv::Size size);
+
+    SubtractorFactory factory;
+    int tiles;
+    int downscale;
+    int edgeThreshold;
+
+    std::vector<cv::Rect> rects;
+    std::vector<cv::Ptr<cv::BackgroundSubtractor> > models;
+
+    // Buffers of the reduced model, reused for each frame
+    cv::Mat luma, input, modelMask, background, scaledBackground;
+
+    long frames;
+    double seconds;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#include "FrameDifferencing.h"
+
+#include <cstdlib>
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/imgproc.hpp>
+
+using namespace cv;
+using namespace std;
+
+FrameRing::FrameRing(double scalingFactor) : scalingFactor(scalingFactor), newest(2), count(0) {
+}
+
+bool FrameRing::push(FrameSource &source) {
+    if (!source.read(frame) || frame.empty())
+        return false;
+
+    // The oldest buffer becomes the newest, resize and cvtColor reuse its memory
+    newest = (newest + 1) % 3;
+    resize(frame, resized, Size(), scalingFactor, scalingFactor, INTER_AREA);
+    cvtColor(resized, slots[newest], COLOR_BGR2GRAY);
+    count++;
+    return true;
+}
+
+void threeFrameDiff(const Mat &prev, const Mat &cur, const Mat &next, Mat &output, int threshold) {
+    CV_Assert(prev.type() == CV_8UC1 && cur.type() == CV_8UC1 && next.type() == CV_8UC1);
+    CV_Assert(prev.size() == cur.size() && next.size() == cur.size());
+    output.create(cur.size(), CV_8UC1);
+
+    // Continuous images are a single row
+    int rows = cur.rows, cols = cur.cols;
+    if (prev.isContinuous() && cur.isContinuous() && next.isContinuous() && output.isContinuous()) {
+        cols *= rows;
+        rows = 1;
+    }
+    uchar t = (uchar) min(max(threshold, 0), 255);
+
+    for (int y = 0; y < rows; y++) {
+        const uchar *p = prev.ptr<uchar>(y);
+        const uchar *c = cur.ptr<uchar>(y);
+        const uchar *n = next.ptr<uchar>(y);
+        uchar *out = output.ptr<uchar>(y);
+        int x = 0;
+#if CV_SIMD
+        const int lanes = v_uint8::nlanes;
+        v_uint8 vt = vx_setall_u8(t);
+        for (; x <= cols - lanes; x += lanes) {
+            v_uint8 vc = vx_load(c + x);
+            v_uint8 d = v_min(v_absdiff(vx_load(n + x), vc), v_absdiff(vc, vx_load(p + x)));
+            // The comparison is already 255 or 0 in each lane
+            v_store(out + x, threshold > 0 ? (d > vt) : d);
+        }
+#endif
+        for (; x < cols; x++) {
+            int d = min(abs(n[x] - c[x]), abs(c[x] - p[x]));
+            out[x] = threshold > 0 ? (d > t ? 255 : 0) : (uchar) d;
+        }
+    }
+}
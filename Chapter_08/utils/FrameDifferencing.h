@@ -0,0 +1,68 @@
+/**
+ * Frame Differencing
+ *
+ * Three frame differencing without allocations in the loop. The FrameRing
+ * keeps the last three gray frames in three buffers allocated with the first
+ * frame; each new frame is resized and converted into the oldest buffer and
+ * only the index of the newest one rotates, the frames are never copied.
+ *
+ * threeFrameDiff computes min(|next - cur|, |cur - prev|) of the three
+ * frames in a single pass, with the universal intrinsics of OpenCV, and can
+ * threshold the result in the same pass.
+ *
+ */
+
+#ifndef FRAME_DIFFERENCING_h
+#define FRAME_DIFFERENCING_h
+
+#include <opencv2/core.hpp>
+
+#include "FrameSource.h"
+
+class FrameRing {
+public:
+    /**
+     * Constructor
+     *
+     * @param scalingFactor scale of the frames of the source
+     */
+    FrameRing(double scalingFactor = 0.75);
+
+    /**
+     * Read the next frame of the source into the oldest buffer
+     * @return false at the end of the source
+     */
+    bool push(FrameSource &source);
+
+    /**
+     * Whether the ring holds three frames
+     */
+    bool isFull() const { return count >= 3; }
+
+    const cv::Mat &prev() const { return slots[(newest + 1) % 3]; }
+
+    const cv::Mat &cur() const { return slots[(newest + 2) % 3]; }
+
+    const cv::Mat &next() const { return slots[newest]; }
+
+private:
+    double scalingFactor;
+    cv::Mat slots[3];
+    int newest;
+    int count;
+    // Buffers of the captured and the resized frame, reused for each frame
+    cv::Mat frame, resized;
+};
+
+/**
+ * Motion of the current frame, min(|next - cur|, |cur - prev|)
+ * @param prev previous gray frame
+ * @param cur current gray frame
+ * @param next next gray frame
+ * @param output motion, reallocated only if its size changes
+ * @param threshold 0 keeps the difference, else the output is 255 where it is over the threshold and 0 elsewhere
+ */
+void threeFrameDiff(const cv::Mat &prev, const cv::Mat &cur, const cv::Mat &next, cv::Mat &output,
+                    int threshold = 0);
+
+#endif
@@ -0,0 +1,142 @@
+#include "FrameSource.h"
+
+#include <cctype>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include <opencv2/imgcodecs.hpp>
+
+using namespace cv;
+using namespace std;
+
+// Frame rate of a paced replay when the input does not have one
+static const double defaultFps = 30;
+
+FrameSource::FrameSource() : live(false), paced(false), fps(0), loops(1), loop(0), nextFile(0), frames(0),
+                             start(0) {}
+
+static bool isNumber(const string &text) {
+    if (text.empty())
+        return false;
+    for (char c: text) {
+        if (!isdigit((unsigned char) c))
+            return false;
+    }
+    return true;
+}
+
+bool FrameSource::open(const string &source, int camera, int apiPreference) {
+    release();
+    input = source;
+    live = input.empty() || isNumber(input);
+    if (live)
+        return capture.open(input.empty() ? camera : atoi(input.c_str()), apiPreference);
+    if (input.find('*') != string::npos) {
+        glob(input, files, false);
+        return !files.empty();
+    }
+    return capture.open(input);
+}
+
+bool FrameSource::open(const CommandLineParser &parser, int camera, int apiPreference) {
+    setPaced(parser.has("paced"), parser.get<double>("fps"));
+    setLoops(parser.get<int>("loops"));
+    return open(parser.get<string>("input"), camera, apiPreference);
+}
+
+void FrameSource::setPaced(bool paced, double fps) {
+    this->paced = paced;
+    this->fps = fps;
+}
+
+void FrameSource::setLoops(int loops) {
+    this->loops = loops;
+}
+
+bool FrameSource::isOpened() const {
+    return capture.isOpened() || !files.empty();
+}
+
+bool FrameSource::isLive() const {
+    return live;
+}
+
+bool FrameSource::readNext(Mat &frame) {
+    if (!files.empty()) {
+        // Unreadable files of the glob are skipped
+        while (nextFile < files.size()) {
+            frame = imread(files[nextFile++]);
+            if (!frame.empty())
+                return true;
+        }
+        frame.release();
+        return false;
+    }
+    return capture.read(frame) && !frame.empty();
+}
+
+bool FrameSource::rewind() {
+    if (!files.empty()) {
+        nextFile = 0;
+        return true;
+    }
+    // Reopen instead of seeking, not all the backends can seek
+    return capture.open(input);
+}
+
+bool FrameSource::read(Mat &frame) {
+    if (!isOpened()) {
+        frame.release();
+        return false;
+    }
+    bool found = readNext(frame);
+    while (!found && !live && (loops <= 0 || loop + 1 < loops)) {
+        loop++;
+        // An input that can not be rewound, or is empty, ends the replay
+        if (!rewind() || !readNext(frame))
+            break;
+        found = true;
+    }
+    if (!found)
+        return false;
+
+    if (frames == 0)
+        start = getTickCount();
+    if (paced && !live) {
+        // The frame n is delivered n / fps seconds after the first one
+        double rate = fps > 0 ? fps : capture.get(CAP_PROP_FPS);
+        if (rate <= 0)
+            rate = defaultFps;
+        double due = frames / rate - (getTickCount() - start) / getTickFrequency();
+        if (due > 0)
+            this_thread::sleep_for(chrono::microseconds((long long) (due * 1e6)));
+    }
+    frames++;
+    return true;
+}
+
+FrameSource &FrameSource::operator>>(Mat &frame) {
+    read(frame);
+    return *this;
+}
+
+int FrameSource::waitDelay(int liveDelay) const {
+    return live ? liveDelay : 1;
+}
+
+void FrameSource::release() {
+    capture.release();
+    files.clear();
+    nextFile = 0;
+    loop = 0;
+    frames = 0;
+}
+
+string FrameSource::report() const {
+    stringstream ss;
+    double seconds = frames > 0 ? (getTickCount() - start) / getTickFrequency() : 0;
+    ss << "Frames: " << frames << " from " << (live ? "camera" : input) << ", loop " << loop + 1 << ", "
+       << (seconds > 0 ? frames / seconds : 0) << " FPS";
+    return ss.str();
+}
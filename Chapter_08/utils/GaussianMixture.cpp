@@ -0,0 +1,322 @@
+#include "GaussianMixture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if !defined(_WIN32)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif
+
+using namespace cv;
+using namespace std;
+
+// The arrays of the state start at multiples of this
+static const size_t stateAlignment = 64;
+
+/**
+ * Header of the state of a model, padded to the alignment
+ */
+struct StateHeader {
+    int width;
+    int height;
+    int channels;
+    int nmixtures;
+    long long frames;
+    char padding[stateAlignment - 4 * sizeof(int) - sizeof(long long)];
+};
+
+static size_t aligned(size_t bytes) {
+    return (bytes + stateAlignment - 1) / stateAlignment * stateAlignment;
+}
+
+MappedSnapshot::MappedSnapshot(const string &file) : data(NULL), size(0) {
+#if !defined(_WIN32)
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        // Private and writable, the pages updated by the models are copied, the file does not change
+        void *mapped = mmap(NULL, (size_t) info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            data = (char *) mapped;
+            size = (size_t) info.st_size;
+        }
+    }
+    ::close(fd);
+#else
+    ifstream in(file.c_str(), ios::binary);
+    buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    data = buffer.empty() ? NULL : &buffer[0];
+    size = buffer.size();
+#endif
+}
+
+MappedSnapshot::~MappedSnapshot() {
+#if !defined(_WIN32)
+    if (data)
+        munmap(data, size);
+#endif
+}
+
+GaussianMixture::GaussianMixture(int history, double varThreshold, bool detectShadows)
+        : history(history), nmixtures(5), varThreshold((float) varThreshold), varThresholdGen(9),
+          backgroundRatio(0.9f), varInit(15), varMin(4), varMax(5 * 15), complexityReductionThreshold(0.05f),
+          detectShadows(detectShadows), shadowValue(127), shadowThreshold(0.5f), channels(0), frames(0) {
+}
+
+void GaussianMixture::initialize(Size frameSize, int frameChannels) {
+    size = frameSize;
+    channels = frameChannels;
+    frames = 0;
+    int pixels = size.area();
+    gmm = Mat::zeros(1, pixels * nmixtures * 2, CV_32F);
+    means = Mat::zeros(1, pixels * nmixtures * channels, CV_32F);
+    modesUsed = Mat::zeros(1, pixels, CV_8U);
+    // The arrays do not point into a snapshot anymore
+    snapshot.release();
+}
+
+/**
+ * Whether a foreground pixel is a shadow: a darker version of one of the
+ * background modes
+ */
+static bool isShadow(const float *data, int channels, int nmodes, const float *gmm, const float *mean,
+                     float varThreshold, float backgroundRatio, float tau) {
+    float totalWeight = 0;
+    for (int mode = 0; mode < nmodes; mode++, mean += channels) {
+        float numerator = 0, denominator = 0;
+        for (int c = 0; c < channels; c++) {
+            numerator += data[c] * mean[c];
+            denominator += mean[c] * mean[c];
+        }
+        if (denominator == 0)
+            return false;
+        if (numerator <= denominator && numerator >= tau * denominator) {
+            float a = numerator / denominator;
+            float dist2a = 0;
+            for (int c = 0; c < channels; c++) {
+                float d = a * mean[c] - data[c];
+                dist2a += d * d;
+            }
+            if (dist2a < varThreshold * gmm[mode * 2 + 1] * a * a)
+                return true;
+        }
+        totalWeight += gmm[mode * 2];
+        if (totalWeight > backgroundRatio)
+            return false;
+    }
+    return false;
+}
+
+void GaussianMixture::apply(InputArray image, OutputArray fgmask, double learningRate) {
+    Mat frame = image.getMat();
+    CV_Assert(frame.depth() == CV_8U && (frame.channels() == 1 || frame.channels() == 3));
+    if (frame.size() != size || frame.channels() != channels || gmm.empty())
+        initialize(frame.size(), frame.channels());
+
+    frames++;
+    learningRate = learningRate >= 0 && frames > 1 ? learningRate : 1.0 / min(2 * frames, (long long) history);
+    fgmask.create(size, CV_8UC1);
+    Mat mask = fgmask.getMat();
+
+    float alphaT = (float) learningRate, alpha1 = 1 - alphaT, prune = -alphaT * complexityReductionThreshold;
+    int nch = channels;
+
+    // Each row is updated by its own task, the pixels are independent
+    parallel_for_(Range(0, size.height), [&](const Range &range) {
+        float data[3];
+        for (int y = range.start; y < range.end; y++) {
+            const uchar *src = frame.ptr<uchar>(y);
+            uchar *dst = mask.ptr<uchar>(y);
+            for (int x = 0; x < size.width; x++, src += nch) {
+                int pixel = y * size.width + x;
+                float *g = gmm.ptr<float>() + (size_t) pixel * nmixtures * 2;
+                float *mean = means.ptr<float>() + (size_t) pixel * nmixtures * nch;
+                uchar &used = modesUsed.ptr<uchar>()[pixel];
+                for (int c = 0; c < nch; c++)
+                    data[c] = src[c];
+
+                bool background = false, fitsPDF = false;
+                int nmodes = used;
+                float totalWeight = 0;
+                float *meanMode = mean;
+                for (int mode = 0; mode < nmodes; mode++, meanMode += nch) {
+                    float weight = alpha1 * g[mode * 2] + prune;
+                    int swapCount = 0;
+                    if (!fitsPDF) {
+                        float var = g[mode * 2 + 1];
+                        float diff[3], dist2 = 0;
+                        for (int c = 0; c < nch; c++) {
+                            diff[c] = meanMode[c] - data[c];
+                            dist2 += diff[c] * diff[c];
+                        }
+                        if (totalWeight < backgroundRatio && dist2 < varThreshold * var)
+                            background = true;
+                        if (dist2 < varThresholdGen * var) {
+                            // Update the matching mode and move it up while it weighs more than the previous
+                            fitsPDF = true;
+                            weight += alphaT;
+                            float k = alphaT / weight;
+                            for (int c = 0; c < nch; c++)
+                                meanMode[c] -= k * diff[c];
+                            g[mode * 2 + 1] = min(max(var + k * (dist2 - var), varMin), varMax);
+                            for (int i = mode; i > 0; i--) {
+                                if (weight < g[(i - 1) * 2])
+                                    break;
+                                swapCount++;
+                                swap(g[i * 2], g[(i - 1) * 2]);
+                                swap(g[i * 2 + 1], g[(i - 1) * 2 + 1]);
+                                for (int c = 0; c < nch; c++)
+                                    swap(mean[i * nch + c], mean[(i - 1) * nch + c]);
+                            }
+                        }
+                    }
+                    // Modes whose weight falls under the pruning are dropped
+                    if (weight < -prune) {
+                        weight = 0;
+                        nmodes--;
+                    }
+                    g[(mode - swapCount) * 2] = weight;
+                    totalWeight += weight;
+                }
+
+                // Normalize the weights
+                totalWeight = totalWeight > 0 ? 1 / totalWeight : 0;
+                for (int mode = 0; mode < nmodes; mode++)
+                    g[mode * 2] *= totalWeight;
+
+                // A new mode, replacing the lightest one if all are used
+                if (!fitsPDF && alphaT > 0) {
+                    int mode = nmodes == nmixtures ? nmixtures - 1 : nmodes++;
+                    if (nmodes == 1) {
+                        g[mode * 2] = 1;
+                    } else {
+                        g[mode * 2] = alphaT;
+                        for (int i = 0; i < nmodes - 1; i++)
+                            g[i * 2] *= alpha1;
+                    }
+                    for (int c = 0; c < nch; c++)
+                        mean[mode * nch + c] = data[c];
+                    g[mode * 2 + 1] = varInit;
+                    for (int i = nmodes - 1; i > 0; i--) {
+                        if (alphaT < g[(i - 1) * 2])
+                            break;
+                        swap(g[i * 2], g[(i - 1) * 2]);
+                        swap(g[i * 2 + 1], g[(i - 1) * 2 + 1]);
+                        for (int c = 0; c < nch; c++)
+                            swap(mean[i * nch + c], mean[(i - 1) * nch + c]);
+                    }
+                }
+                used = (uchar) nmodes;
+
+                if (background)
+                    dst[x] = 0;
+                else if (detectShadows &&
+                         isShadow(data, nch, nmodes, g, mean, varThreshold, backgroundRatio, shadowThreshold))
+                    dst[x] = shadowValue;
+                else
+                    dst[x] = 255;
+            }
+        }
+    });
+}
+
+void GaussianMixture::getBackgroundImage(OutputArray backgroundImage) const {
+    if (gmm.empty()) {
+        backgroundImage.release();
+        return;
+    }
+    backgroundImage.create(size, CV_8UC(channels));
+    Mat background = backgroundImage.getMat();
+    for (int y = 0; y < size.height; y++) {
+        uchar *dst = background.ptr<uchar>(y);
+        for (int x = 0; x < size.width; x++, dst += channels) {
+            int pixel = y * size.width + x;
+            const float *g = gmm.ptr<float>() + (size_t) pixel * nmixtures * 2;
+            const float *mean = means.ptr<float>() + (size_t) pixel * nmixtures * channels;
+            // Weighted mean of the background modes
+            float value[3] = {0, 0, 0}, totalWeight = 0;
+            int nmodes = modesUsed.ptr<uchar>()[pixel];
+            for (int mode = 0; mode < nmodes; mode++) {
+                for (int c = 0; c < channels; c++)
+                    value[c] += g[mode * 2] * mean[mode * channels + c];
+                totalWeight += g[mode * 2];
+                if (totalWeight > backgroundRatio)
+                    break;
+            }
+            for (int c = 0; c < channels; c++)
+                dst[c] = saturate_cast<uchar>(totalWeight > 0 ? value[c] / totalWeight : 0);
+        }
+    }
+}
+
+/**
+ * Write an array and its padding to the alignment
+ */
+static void writeAligned(ostream &out, const Mat &array) {
+    static const char zeros[stateAlignment] = {0};
+    size_t bytes = array.total() * array.elemSize();
+    out.write((const char *) array.data, bytes);
+    out.write(zeros, aligned(bytes) - bytes);
+}
+
+bool GaussianMixture::writeState(ostream &out) const {
+    if (gmm.empty())
+        return false;
+    StateHeader header;
+    memset(&header, 0, sizeof(header));
+    header.width = size.width;
+    header.height = size.height;
+    header.channels = channels;
+    header.nmixtures = nmixtures;
+    header.frames = frames;
+    out.write((const char *) &header, sizeof(header));
+    writeAligned(out, gmm);
+    writeAligned(out, means);
+    writeAligned(out, modesUsed);
+    return (bool) out;
+}
+
+bool GaussianMixture::readState(const Ptr<MappedSnapshot> &file, size_t &offset, Size frameSize, int frameChannels) {
+    if (!file->data || offset + sizeof(StateHeader) > file->size)
+        return false;
+    StateHeader header;
+    memcpy(&header, file->data + offset, sizeof(header));
+    if (header.width != frameSize.width || header.height != frameSize.height || header.nmixtures != nmixtures ||
+        header.channels != frameChannels || (header.channels != 1 && header.channels != 3) || header.frames < 0)
+        return false;
+    size_t pixels = (size_t) frameSize.area();
+    size_t gmmBytes = pixels * nmixtures * 2 * sizeof(float);
+    size_t meansBytes = pixels * nmixtures * header.channels * sizeof(float);
+    size_t stateBytes = sizeof(header) + aligned(gmmBytes) + aligned(meansBytes) + aligned(pixels);
+    if (offset + stateBytes > file->size)
+        return false;
+
+    // apply indexes the modes of each pixel with its count, more than nmixtures is a corrupt snapshot
+    char *data = file->data + offset + sizeof(header);
+    const uchar *used = (const uchar *) data + aligned(gmmBytes) + aligned(meansBytes);
+    for (size_t pixel = 0; pixel < pixels; pixel++) {
+        if (used[pixel] > nmixtures)
+            return false;
+    }
+
+    // The arrays point into the mapping, nothing is copied
+    gmm = Mat(1, (int) (pixels * nmixtures * 2), CV_32F, data);
+    data += aligned(gmmBytes);
+    means = Mat(1, (int) (pixels * nmixtures * header.channels), CV_32F, data);
+    data += aligned(meansBytes);
+    modesUsed = Mat(1, (int) pixels, CV_8U, data);
+    size = frameSize;
+    channels = header.channels;
+    frames = header.frames;
+    snapshot = file;
+    offset += stateBytes;
+    return true;
+}
@@ -0,0 +1,106 @@
+/**
+ * Gaussian Mixture
+ *
+ * Background subtractor with the mixture of gaussians of MOG2 (Zivkovic),
+ * the same model and parameters as createBackgroundSubtractorMOG2, whose
+ * state is kept by this class so it can be saved and restored. MOG2 of
+ * OpenCV does not give access to the means, variances and weights of its
+ * pixels, so after a restart it learns the background from scratch.
+ *
+ * The state is written as fixed size arrays, aligned to 64 bytes, so a
+ * snapshot mapped in memory is used as the model without parsing or copying
+ * it: the arrays of the model point into the private mapping of the file,
+ * and the pages are copied by the system only when the model updates them.
+ *
+ */
+
+#ifndef GAUSSIAN_MIXTURE_h
+#define GAUSSIAN_MIXTURE_h
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/video/background_segm.hpp>
+
+/**
+ * Whole file mapped in memory, private to the process, shared by the models
+ * restored from it and unmapped when the last one releases it
+ */
+class MappedSnapshot {
+public:
+    MappedSnapshot(const std::string &file);
+
+    ~MappedSnapshot();
+
+    char *data;
+    size_t size;
+
+private:
+#if defined(_WIN32)
+    std::vector<char> buffer;
+#endif
+};
+
+class GaussianMixture : public cv::BackgroundSubtractor {
+public:
+    /**
+     * Constructor, same parameters and defaults as createBackgroundSubtractorMOG2
+     *
+     * @param history frames that affect the model
+     * @param varThreshold squared Mahalanobis distance of the background
+     * @param detectShadows mark the shadows with 127 in the mask
+     */
+    GaussianMixture(int history = 500, double varThreshold = 16, bool detectShadows = true);
+
+    /**
+     * Update the model with a 8 bits gray or color frame and get its foreground mask
+     */
+    void apply(cv::InputArray image, cv::OutputArray fgmask, double learningRate = -1);
+
+    void getBackgroundImage(cv::OutputArray backgroundImage) const;
+
+    /**
+     * Write the state of the model: a header with its size, then the
+     * weights and variances, the means and the number of modes of each pixel
+     */
+    bool writeState(std::ostream &out) const;
+
+    /**
+     * Use the state at an offset of a snapshot as the model
+     * @param snapshot mapped file, kept while the model uses it
+     * @param offset position of the state, moved after it
+     * @param size size of the frames of the model
+     * @param channels channels of the frames of the model, 1 or 3
+     * @return false if the state is not of a model of that size and channels, or it is corrupt
+     */
+    bool readState(const cv::Ptr<MappedSnapshot> &snapshot, size_t &offset, cv::Size size, int channels);
+
+private:
+    /**
+     * Empty model for the frames of a size and type
+     */
+    void initialize(cv::Size frameSize, int frameChannels);
+
+    int history;
+    int nmixtures;
+    // Squared Mahalanobis distance of the background, and of the match of a mode
+    float varThreshold, varThresholdGen;
+    // Weight of the modes that are the background
+    float backgroundRatio;
+    float varInit, varMin, varMax;
+    float complexityReductionThreshold;
+    bool detectShadows;
+    uchar shadowValue;
+    float shadowThreshold;
+
+    cv::Size size;
+    int channels;
+    long long frames;
+    // Weight and variance of each mode, the means of each mode and the modes of each pixel
+    cv::Mat gmm, means, modesUsed;
+    cv::Ptr<MappedSnapshot> snapshot;
+};
+
+#endif
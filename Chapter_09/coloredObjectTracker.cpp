@@ -5,18 +5,38 @@
 
 #include <iostream>
 
+#include "utils/FrameSource.h"
+
 using namespace cv;
 using namespace std;
 
+const char* keys =
+{
+    "{help h usage ? | | print this message}"
+    FRAME_SOURCE_KEYS
+};
+
 int main(int argc, char* argv[])
 {
-    // Create the capture object
-    // 0 -> input arg that specifies it should take the input from the webcam
-    VideoCapture cap(0);
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 9. Colored object tracker v1.0.0");
+    if(parser.has("help"))
+    {
+        parser.printMessage();
+        return 0;
+    }
+    if(!parser.check())
+    {
+        parser.printErrors();
+        return 0;
+    }
     
-    if(!cap.isOpened())
+    // Create the capture object, the webcam or the input to replay
+    FrameSource cap;
+    
+    if(!cap.open(parser))
     {
-        cerr << "Unable to open the webcam. Exiting!" << endl;
+        cerr << "Unable to open the input. Exiting!" << endl;
         return -1;
     }
     
@@ -65,11 +85,13 @@ int main(int argc, char* argv[])
         // Get the keyboard input and check if it's 'Esc'
         // 30 -> wait for 30 ms
         // 27 -> ASCII value of 'ESC' key
-        ch = waitKey(30);
+        ch = waitKey(cap.waitDelay(30));
         if (ch == 27) {
             break;
         }
     }
     
+    cout << cap.report() << endl;
+    
     return 0;
 }
@@ -6,9 +6,17 @@
 
 #include <iostream>
 
+#include "utils/FrameSource.h"
+
 using namespace cv;
 using namespace std;
 
+const char* keys =
+{
+    "{help h usage ? | | print this message}"
+    FRAME_SOURCE_KEYS
+};
+
 // Function to compute the optical flow map
 void drawOpticalFlow(const Mat& flowImage, Mat& flowImageGray)
 {
@@ -32,15 +40,27 @@ void drawOpticalFlow(const Mat& flowImage, Mat& flowImageGray)
     }
 }
 
-int main(int, char** argv)
+int main(int argc, char** argv)
 {
-    // Create the capture object
-    // 0 -> input arg that specifies it should take the input from the webcam
-    VideoCapture cap(0);
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 9. Farneback optical flow v1.0.0");
+    if(parser.has("help"))
+    {
+        parser.printMessage();
+        return 0;
+    }
+    if(!parser.check())
+    {
+        parser.printErrors();
+        return 0;
+    }
     
-    if(!cap.isOpened())
+    // Create the capture object, the webcam or the input to replay
+    FrameSource cap;
+    
+    if(!cap.open(parser))
     {
-        cerr << "Unable to open the webcam. Exiting!" << endl;
+        cerr << "Unable to open the input. Exiting!" << endl;
         return -1;
     }
     
@@ -90,7 +110,7 @@ int main(int, char** argv)
         }
         
         // Break out of the loop if the user presses the Esc key
-        ch = waitKey(10);
+        ch = waitKey(cap.waitDelay(10));
         if(ch == 27)
             break;
         
@@ -98,6 +118,8 @@ int main(int, char** argv)
         std::swap(prevGray, curGray);
     }
     
+    cout << cap.report() << endl;
+    
     return 0;
 }
 
@@ -6,15 +6,30 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "utils/FrameSource.h"
+
 using namespace cv;
 using namespace std;
 
+const char* keys =
+{
+    "{help h usage ? | | print this message}"
+    "{@numCorners | 100 | Maximum number of corners to detect}"
+    FRAME_SOURCE_KEYS
+};
+
 int main(int argc, char* argv[])
 {
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 9. Good features to track v1.0.0");
+    if(parser.has("help"))
+    {
+        parser.printMessage();
+        return 0;
+    }
+    
     // Read the input value for the number of corners
-    int numCorners;
-    istringstream iss(argv[1]);
-    iss >> numCorners;
+    int numCorners = parser.get<int>("@numCorners");
     
     // Check if 'numCorners' is positive
     if( numCorners < 1 )
@@ -30,13 +45,18 @@ int main(int argc, char* argv[])
     
     char ch;
     
-    // Create the capture object
-    // 0 -> input arg that specifies it should take the input from the webcam
-    VideoCapture cap(0);
+    if(!parser.check())
+    {
+        parser.printErrors();
+        return 0;
+    }
+    
+    // Create the capture object, the webcam or the input to replay
+    FrameSource cap;
     
-    if(!cap.isOpened())
+    if(!cap.open(parser))
     {
-        cerr << "Unable to open the webcam. Exiting!" << endl;
+        cerr << "Unable to open the input. Exiting!" << endl;
         return -1;
     }
     
@@ -49,6 +69,10 @@ int main(int argc, char* argv[])
         // Capture the current frame
         cap >> frame;
         
+        // Check if 'frame' is empty
+        if(frame.empty())
+            break;
+        
         // Resize the frame
         resize(frame, frame, Size(), scalingFactor, scalingFactor, INTER_AREA);
         
@@ -87,12 +111,14 @@ int main(int argc, char* argv[])
         
         // Get the keyboard input and check if it's 'Esc'
         // 27 -> ASCII value of 'Esc' key
-        ch = waitKey(30);
+        ch = waitKey(cap.waitDelay(30));
         if (ch == 27) {
             break;
         }
     }
     
+    cout << cap.report() << endl;
+    
     // Release the video capture object
     cap.release();
     
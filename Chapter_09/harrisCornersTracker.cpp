@@ -6,15 +6,30 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "utils/FrameSource.h"
+
 using namespace cv;
 using namespace std;
 
+const char* keys =
+{
+    "{help h usage ? | | print this message}"
+    "{@blockSize | 2 | Size of the neighbourhood of each corner}"
+    FRAME_SOURCE_KEYS
+};
+
 int main(int argc, char* argv[])
 {
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 9. Harris corners tracker v1.0.0");
+    if(parser.has("help"))
+    {
+        parser.printMessage();
+        return 0;
+    }
+    
     // Read the input value for the size of the block
-    int blockSize;
-    istringstream iss(argv[1]);
-    iss >> blockSize;
+    int blockSize = parser.get<int>("@blockSize");
     
     // Check if 'blockSize' is smaller than 2
     if(blockSize < 2)
@@ -36,13 +51,18 @@ int main(int argc, char* argv[])
     
     char ch;
     
-    // Create the capture object
-    // 0 -> input arg that specifies it should take the input from the webcam
-    VideoCapture cap(0);
+    if(!parser.check())
+    {
+        parser.printErrors();
+        return 0;
+    }
+    
+    // Create the capture object, the webcam or the input to replay
+    FrameSource cap;
     
-    if(!cap.isOpened())
+    if(!cap.open(parser))
     {
-        cerr << "Unable to open the webcam. Exiting!" << endl;
+        cerr << "Unable to open the input. Exiting!" << endl;
         return -1;
     }
     
@@ -57,6 +77,10 @@ int main(int argc, char* argv[])
         // Capture the current frame
         cap >> frame;
         
+        // Check if 'frame' is empty
+        if(frame.empty())
+            break;
+        
         // Resize the frame
         resize(frame, frame, Size(), scalingFactor, scalingFactor, INTER_AREA);
         
@@ -89,12 +113,14 @@ int main(int argc, char* argv[])
         
         // Get the keyboard input and check if it's 'Esc'
         // 27 -> ASCII value of 'Esc' key
-        ch = waitKey(10);
+        ch = waitKey(cap.waitDelay(10));
         if (ch == 27) {
             break;
         }
     }
     
+    cout << cap.report() << endl;
+    
     // Release the video capture object
     cap.release();
     
@@ -6,9 +6,17 @@
 
 #include <iostream>
 
+#include "utils/FrameSource.h"
+
 using namespace cv;
 using namespace std;
 
+const char* keys =
+{
+    "{help h usage ? | | print this message}"
+    FRAME_SOURCE_KEYS
+};
+
 bool pointTrackingFlag = false;
 Point2f currentPoint;
 
@@ -28,13 +36,25 @@ void onMouse(int event, int x, int y, int, void*)
 
 int main(int argc, char* argv[])
 {
-    // Create the capture object
-    // 0 -> input arg that specifies it should take the input from the webcam
-    VideoCapture cap(0);
+    CommandLineParser parser(argc, argv, keys);
+    parser.about("Chapter 9. Lucas Kanade tracker v1.0.0");
+    if(parser.has("help"))
+    {
+        parser.printMessage();
+        return 0;
+    }
+    if(!parser.check())
+    {
+        parser.printErrors();
+        return 0;
+    }
     
-    if(!cap.isOpened())
+    // Create the capture object, the webcam or the input to replay
+    FrameSource cap;
+    
+    if(!cap.open(parser))
     {
-        cerr << "Unable to open the webcam. Exiting!" << endl;
+        cerr << "Unable to open the input. Exiting!" << endl;
         return -1;
     }
     
@@ -145,7 +165,7 @@ int main(int argc, char* argv[])
         imshow(windowName, image);
         
         // Check if the user pressed the Esc key
-        char ch = waitKey(10);
+        char ch = waitKey(cap.waitDelay(10));
         if(ch == 27)
             break;
         
@@ -156,6 +176,8 @@ int main(int argc, char* argv[])
         cv::swap(prevGrayImage, curGrayImage);
     }
     
+    cout << cap.report() << endl;
+    
     return 0;
 }
 